@@ -0,0 +1,110 @@
+/*
+ * affinity.c - CPU pinning and real-time scheduling for Snake Ludo
+ * CS39002 Operating Systems Laboratory
+ *
+ * Author: Ashutosh Sharma
+ * Roll: 23CS10005
+ */
+
+#define _GNU_SOURCE
+#include "affinity.h"
+
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// the affinity before this process first pinned itself: a role forked
+// from a pinned one (players from the PP) gets it back when it has no CPU
+// list of its own
+cpu_set_t unpinned_set;
+int pinned = 0;
+
+// parse "0-3,6" into set, returns -1 if malformed
+int parse_cpu_list(const char *list, cpu_set_t *set) {
+  CPU_ZERO(set);
+  const char *p = list;
+
+  while (*p) {
+    char *end;
+    long lo = strtol(p, &end, 10), hi = lo;
+    if (end == p || lo < 0)
+      return -1;
+    p = end;
+    if (*p == '-') {
+      hi = strtol(p + 1, &end, 10);
+      if (end == p + 1 || hi < lo)
+        return -1;
+      p = end;
+    }
+    if (hi >= CPU_SETSIZE)
+      return -1;
+    for (long cpu = lo; cpu <= hi; cpu++)
+      CPU_SET(cpu, set);
+    if (*p == ',')
+      p++;
+    else if (*p != '\0')
+      return -1;
+  }
+  return CPU_COUNT(set) > 0 ? 0 : -1;
+}
+
+// pin the calling process to cpus, or with cpus NULL undo a pinning
+// inherited through fork(), and optionally switch it to SCHED_FIFO;
+// failures are reported but not fatal
+int sched_setup(const char *role, const char *cpus, int fifo_prio) {
+  int ret = 0;
+
+  if (cpus != NULL && *cpus) {
+    cpu_set_t set;
+    if (parse_cpu_list(cpus, &set) < 0) {
+      fprintf(stderr, "%s: bad CPU list '%s'\n", role, cpus);
+      ret = -1;
+    } else if (!pinned &&
+               sched_getaffinity(0, sizeof(unpinned_set), &unpinned_set) < 0) {
+      perror("sched_getaffinity");
+      ret = -1;
+    } else if (sched_setaffinity(0, sizeof(set), &set) < 0) {
+      perror("sched_setaffinity");
+      ret = -1;
+    } else {
+      pinned = 1;
+    }
+  } else if (pinned) {
+    if (sched_setaffinity(0, sizeof(unpinned_set), &unpinned_set) < 0) {
+      perror("sched_setaffinity");
+      ret = -1;
+    } else {
+      pinned = 0;
+    }
+  }
+
+  if (fifo_prio > 0) {
+    // children pick their own policy, xterm must not inherit ours
+    struct sched_param param = {.sched_priority = fifo_prio};
+    if (sched_setscheduler(0, SCHED_FIFO | SCHED_RESET_ON_FORK, &param) < 0) {
+      fprintf(stderr, "%s: SCHED_FIFO %d not permitted, staying on CFS\n",
+              role, fifo_prio);
+      ret = -1;
+    }
+  }
+  return ret;
+}
+
+int sched_setup_from_env(const char *role) {
+  char name[64];
+  snprintf(name, sizeof(name), "LUDO_CPUS_%s", role);
+  const char *cpus = getenv(name);
+  const char *fifo = getenv("LUDO_SCHED_FIFO");
+  return sched_setup(role, cpus, fifo ? atoi(fifo) : 0);
+}
+
+// hand a CPU list to a child role through the environment
+void sched_export(const char *role, const char *cpus) {
+  char name[64];
+  snprintf(name, sizeof(name), "LUDO_CPUS_%s", role);
+  if (cpus != NULL)
+    setenv(name, cpus, 1);
+  else
+    unsetenv(name);
+}
@@ -0,0 +1,20 @@
+/*
+ * affinity.h - CPU pinning and real-time scheduling for Snake Ludo
+ * CS39002 Operating Systems Laboratory
+ *
+ * The CP passes the settings to BP, PP and players through the
+ * environment (LUDO_CPUS_<ROLE>, LUDO_SCHED_FIFO), since they are started
+ * through xterm and cannot be given extra arguments cleanly.
+ *
+ * Author: Ashutosh Sharma
+ * Roll: 23CS10005
+ */
+
+#ifndef AFFINITY_H
+#define AFFINITY_H
+
+int sched_setup(const char *role, const char *cpus, int fifo_prio);
+int sched_setup_from_env(const char *role);
+void sched_export(const char *role, const char *cpus);
+
+#endif
@@ -0,0 +1,508 @@
+/*
+ * batch.c - Structure-of-arrays simulator for many games at once
+ * CS39002 Operating Systems Laboratory
+ *
+ * Author: Ashutosh Sharma
+ * Roll: 23CS10005
+ */
+
+#include "batch.h"
+
+#include <immintrin.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef int (*step_fn)(struct batch *, int32_t *);
+
+static inline uint32_t xorshift32(uint32_t x) {
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  return x;
+}
+
+// die from the top 16 bits, so it fits a 32-bit multiply in every lane
+static inline int32_t die32(uint32_t x) {
+  return (int32_t)(((x >> 16) * 6) >> 16) + 1;
+}
+
+int batch_init(struct batch *b, const int *board, int num_players,
+               int lanes) {
+  memset(b, 0, sizeof(*b));
+  lanes = (lanes + BATCH_WIDTH - 1) / BATCH_WIDTH * BATCH_WIDTH;
+  b->lanes = lanes;
+  b->num_players = num_players;
+
+  b->pos = aligned_alloc(32, (size_t)num_players * lanes * sizeof(int32_t));
+  b->cur = aligned_alloc(32, lanes * sizeof(int32_t));
+  b->active = aligned_alloc(32, lanes * sizeof(int32_t));
+  b->turns = aligned_alloc(32, lanes * sizeof(int32_t));
+  b->first_turn = aligned_alloc(32, lanes * sizeof(int32_t));
+  b->winner = aligned_alloc(32, lanes * sizeof(int32_t));
+  b->rng = aligned_alloc(32, lanes * sizeof(uint32_t));
+  b->flip = aligned_alloc(32, lanes * sizeof(int32_t));
+  b->game = malloc(lanes * sizeof(long));
+  b->occ = aligned_alloc(32, OCC_WORDS * lanes * sizeof(uint32_t));
+  if (!b->pos || !b->occ || !b->cur || !b->active || !b->turns ||
+      !b->first_turn || !b->winner || !b->rng || !b->flip || !b->game) {
+    batch_free(b);
+    return -1;
+  }
+
+  // chain lengths as game_turn() would follow them on an empty board;
+  // other tokens can only cut a chain short
+  for (int cell = 0; cell < BOARD_SIZE; cell++) {
+    b->jump[cell] = board[cell];
+    unsigned char visited[BOARD_SIZE] = {0};
+    int pos = cell, hops = 0;
+    while (pos > 0 && pos < FINISH_CELL && board[pos] != 0 && !visited[pos]) {
+      visited[pos] = 1;
+      pos += board[pos];
+      hops++;
+    }
+    b->steps[cell] = hops;
+    b->link[cell] = hops << 8 | (board[cell] & 0xff);
+    if (hops > b->max_steps)
+      b->max_steps = hops;
+  }
+
+  for (int lane = 0; lane < lanes; lane++) {
+    b->active[lane] = 0;
+    b->turns[lane] = 0;
+  }
+  return 0;
+}
+
+void batch_free(struct batch *b) {
+  free(b->pos);
+  free(b->cur);
+  free(b->active);
+  free(b->turns);
+  free(b->first_turn);
+  free(b->winner);
+  free(b->rng);
+  free(b->occ);
+  free(b->flip);
+  free(b->game);
+  b->pos = NULL;
+}
+
+void sim_result_merge(struct sim_result *into, const struct sim_result *from) {
+  into->games += from->games;
+  into->turns += from->turns;
+  into->len_sq += from->len_sq;
+  into->win_turns += from->win_turns;
+  into->win_sq += from->win_sq;
+  for (int i = 0; i < MAX_PLAYERS; i++)
+    into->wins[i] += from->wins[i];
+}
+
+// start the next game of the range in a lane, on that game's dice stream
+static void lane_reset(struct batch *b, int lane) {
+  long id = b->next_game++;
+  uint64_t stream = b->range.antithetic ? id / 2 : id;
+  uint32_t x = (uint32_t)rng_stream(b->range.seed, stream);
+  b->rng[lane] = x ? x : 1; // xorshift must not start at 0
+  b->flip[lane] = b->range.antithetic && (id & 1) ? -1 : 0;
+  b->game[lane] = id;
+  for (int p = 0; p < b->num_players; p++)
+    b->pos[p * b->lanes + lane] = 0;
+  for (int w = 0; w < OCC_WORDS; w++)
+    b->occ[w * b->lanes + lane] = 0;
+  b->cur[lane] = -1;
+  b->active[lane] = b->num_players;
+  b->turns[lane] = 0;
+  b->first_turn[lane] = 0;
+  b->winner[lane] = -1;
+}
+
+// token of player from one cell to another, keeping the bitmap in step
+static inline void lane_move(struct batch *b, int lane, int player, int from,
+                             int to) {
+  b->pos[player * b->lanes + lane] = to;
+  if (from > 0 && from < FINISH_CELL)
+    b->occ[(from >> 5) * b->lanes + lane] &= ~(1u << (from & 31));
+  if (to > 0 && to < FINISH_CELL)
+    b->occ[(to >> 5) * b->lanes + lane] |= 1u << (to & 31);
+}
+
+// another player's token on cell; the mover's own token is on from
+static inline int lane_occupied(struct batch *b, int lane, int cell, int from) {
+  if (cell <= 0 || cell >= FINISH_CELL || cell == from)
+    return 0;
+  return (b->occ[(cell >> 5) * b->lanes + lane] >> (cell & 31)) & 1;
+}
+
+// one turn in every live lane; finished lanes are appended to done
+static int step_scalar(struct batch *b, int32_t *done) {
+  const int lanes = b->lanes, players = b->num_players;
+  int ndone = 0;
+
+  for (int lane = 0; lane < lanes; lane++) {
+    if (b->active[lane] <= 0)
+      continue;
+
+    int c = b->cur[lane], next = c;
+    for (int off = 1; off <= players; off++) {
+      int cand = c + off;
+      if (cand >= players)
+        cand -= players;
+      if (b->pos[cand * lanes + lane] != FINISH_CELL) {
+        next = cand;
+        break;
+      }
+    }
+
+    uint32_t x = b->rng[lane];
+    x = xorshift32(x);
+    int d1 = die32(x);
+    x = xorshift32(x);
+    int d2 = die32(x);
+    x = xorshift32(x);
+    int d3 = die32(x);
+    b->rng[lane] = x;
+    if (b->flip[lane]) {
+      d1 = 7 - d1;
+      d2 = 7 - d2;
+      d3 = 7 - d3;
+    }
+
+    int total = d1 + (d1 == 6 ? d2 + (d2 == 6 ? d3 : 0) : 0);
+    int cancel = d1 == 6 && d2 == 6 && d3 == 6;
+
+    int from = b->pos[next * lanes + lane];
+    int target = from + total;
+    int ok = !cancel && target <= FINISH_CELL &&
+             !lane_occupied(b, lane, target, from);
+    int np = ok ? target : from;
+
+    if (ok) {
+      int steps = b->steps[np];
+      for (int h = 0; h < steps; h++) {
+        int cell = np + b->jump[np];
+        if (lane_occupied(b, lane, cell, from))
+          break;
+        np = cell;
+      }
+    }
+
+    lane_move(b, lane, next, from, np);
+    b->cur[lane] = next;
+    b->turns[lane]++;
+    if (ok && np == FINISH_CELL) {
+      if (b->first_turn[lane] == 0) {
+        b->first_turn[lane] = b->turns[lane];
+        b->winner[lane] = next;
+      }
+      if (--b->active[lane] == 0)
+        done[ndone++] = lane;
+    }
+  }
+  return ndone;
+}
+
+__attribute__((target("avx2"))) static inline __m256i
+xorshift32_avx2(__m256i x) {
+  x = _mm256_xor_si256(x, _mm256_slli_epi32(x, 13));
+  x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 17));
+  return _mm256_xor_si256(x, _mm256_slli_epi32(x, 5));
+}
+
+__attribute__((target("avx2"))) static inline __m256i die_avx2(__m256i x) {
+  __m256i hi = _mm256_srli_epi32(x, 16);
+  __m256i six = _mm256_mullo_epi32(hi, _mm256_set1_epi32(6));
+  return _mm256_add_epi32(_mm256_srli_epi32(six, 16), _mm256_set1_epi32(1));
+}
+
+// 0 < cell < 100, the cells a token can block
+__attribute__((target("avx2"))) static inline __m256i
+cell_inside(__m256i cell) {
+  return _mm256_and_si256(
+      _mm256_cmpgt_epi32(cell, _mm256_setzero_si256()),
+      _mm256_cmpgt_epi32(_mm256_set1_epi32(FINISH_CELL), cell));
+}
+
+// lanes where some other player's token is on cell (0 < cell < 100);
+// occ holds this block's bitmap words, and the mover's own cell is from
+__attribute__((target("avx2"))) static inline __m256i
+occupied_avx2(const __m256i *occ, __m256i cell, __m256i from) {
+  __m256i w = _mm256_srli_epi32(cell, 5);
+  __m256i bits = occ[0];
+  for (int i = 1; i < OCC_WORDS; i++)
+    bits = _mm256_blendv_epi8(bits, occ[i],
+                              _mm256_cmpeq_epi32(w, _mm256_set1_epi32(i)));
+  bits = _mm256_srlv_epi32(bits, _mm256_and_si256(cell, _mm256_set1_epi32(31)));
+  __m256i hit = _mm256_cmpeq_epi32(_mm256_and_si256(bits, _mm256_set1_epi32(1)),
+                                   _mm256_set1_epi32(1));
+  __m256i self = _mm256_cmpeq_epi32(cell, from);
+  return _mm256_andnot_si256(self, _mm256_and_si256(hit, cell_inside(cell)));
+}
+
+__attribute__((target("avx2"))) static int step_avx2(struct batch *b,
+                                                      int32_t *done) {
+  const int lanes = b->lanes, players = b->num_players;
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i six = _mm256_set1_epi32(6);
+  const __m256i seven = _mm256_set1_epi32(7);
+  const __m256i finish = _mm256_set1_epi32(FINISH_CELL);
+  const __m256i vplayers = _mm256_set1_epi32(players);
+  const __m256i one = _mm256_set1_epi32(1);
+  const __m256i low5 = _mm256_set1_epi32(31);
+  int ndone = 0;
+
+  for (int l = 0; l < lanes; l += BATCH_WIDTH) {
+    __m256i act = _mm256_load_si256((__m256i *)(b->active + l));
+    __m256i live = _mm256_cmpgt_epi32(act, zero);
+    if (_mm256_testz_si256(live, live))
+      continue;
+    __m256i occ[OCC_WORDS];
+    for (int w = 0; w < OCC_WORDS; w++)
+      occ[w] = _mm256_load_si256((__m256i *)(b->occ + w * lanes + l));
+
+    // next player not at 100 cyclically after cur, and where they stand;
+    // one pass over the rows instead of a gather per candidate
+    __m256i c = _mm256_load_si256((__m256i *)(b->cur + l));
+    __m256i next = c, from = zero;
+    __m256i best = _mm256_set1_epi32(players);
+    __m256i dist = _mm256_sub_epi32(_mm256_set1_epi32(-1), c); // p - c - 1
+    for (int p = 0; p < players; p++) {
+      __m256i row = _mm256_load_si256((__m256i *)(b->pos + p * lanes + l));
+      __m256i d = _mm256_add_epi32(
+          dist, _mm256_and_si256(_mm256_cmpgt_epi32(zero, dist), vplayers));
+      __m256i better = _mm256_andnot_si256(_mm256_cmpeq_epi32(row, finish),
+                                           _mm256_cmpgt_epi32(best, d));
+      best = _mm256_blendv_epi8(best, d, better);
+      next = _mm256_blendv_epi8(next, _mm256_set1_epi32(p), better);
+      from = _mm256_blendv_epi8(from, row, better);
+      dist = _mm256_add_epi32(dist, one);
+    }
+
+    // three dice every turn; masks decide how many count
+    __m256i x = _mm256_load_si256((__m256i *)(b->rng + l));
+    x = xorshift32_avx2(x);
+    __m256i d1 = die_avx2(x);
+    x = xorshift32_avx2(x);
+    __m256i d2 = die_avx2(x);
+    x = xorshift32_avx2(x);
+    __m256i d3 = die_avx2(x);
+    _mm256_store_si256((__m256i *)(b->rng + l), x);
+    __m256i flip = _mm256_load_si256((__m256i *)(b->flip + l));
+    d1 = _mm256_blendv_epi8(d1, _mm256_sub_epi32(seven, d1), flip);
+    d2 = _mm256_blendv_epi8(d2, _mm256_sub_epi32(seven, d2), flip);
+    d3 = _mm256_blendv_epi8(d3, _mm256_sub_epi32(seven, d3), flip);
+
+    __m256i s1 = _mm256_cmpeq_epi32(d1, six);
+    __m256i s2 = _mm256_cmpeq_epi32(d2, six);
+    __m256i s3 = _mm256_cmpeq_epi32(d3, six);
+    __m256i tail = _mm256_add_epi32(d2, _mm256_and_si256(s2, d3));
+    __m256i total = _mm256_add_epi32(d1, _mm256_and_si256(s1, tail));
+    __m256i cancel = _mm256_and_si256(_mm256_and_si256(s1, s2), s3);
+
+    __m256i target = _mm256_add_epi32(from, total);
+
+    __m256i ok = _mm256_andnot_si256(cancel, live);
+    ok = _mm256_andnot_si256(_mm256_cmpgt_epi32(target, finish), ok);
+    ok = _mm256_andnot_si256(occupied_avx2(occ, target, from), ok);
+    __m256i np = _mm256_blendv_epi8(from, target, ok);
+
+    // snakes and ladders: gather the jump for every lane still chaining;
+    // the first gather also brings the chain length from the start cell
+    __m256i link = _mm256_i32gather_epi32(b->link, np, 4);
+    __m256i steps = _mm256_srai_epi32(link, 8);
+    __m256i chain = ok;
+    for (int h = 0; h < b->max_steps; h++) {
+      __m256i left = _mm256_cmpgt_epi32(steps, _mm256_set1_epi32(h));
+      __m256i go = _mm256_and_si256(chain, left);
+      if (_mm256_testz_si256(go, go))
+        break;
+      if (h > 0)
+        link = _mm256_i32gather_epi32(b->link, np, 4);
+      __m256i jump = _mm256_srai_epi32(_mm256_slli_epi32(link, 24), 24);
+      __m256i cell = _mm256_add_epi32(np, jump);
+      chain = _mm256_andnot_si256(occupied_avx2(occ, cell, from), go);
+      np = _mm256_blendv_epi8(np, cell, chain);
+    }
+
+    // write the moved token back into its player's row
+    for (int p = 0; p < players; p++) {
+      __m256i *row = (__m256i *)(b->pos + p * lanes + l);
+      __m256i mine = _mm256_and_si256(
+          ok, _mm256_cmpeq_epi32(next, _mm256_set1_epi32(p)));
+      _mm256_store_si256(row, _mm256_blendv_epi8(_mm256_load_si256(row), np,
+                                                 mine));
+    }
+
+    // and move its bit in the occupancy bitmap
+    __m256i clear = _mm256_and_si256(ok, cell_inside(from));
+    __m256i set = _mm256_and_si256(ok, cell_inside(np));
+    __m256i clear_bit = _mm256_and_si256(
+        clear, _mm256_sllv_epi32(one, _mm256_and_si256(from, low5)));
+    __m256i set_bit = _mm256_and_si256(
+        set, _mm256_sllv_epi32(one, _mm256_and_si256(np, low5)));
+    for (int w = 0; w < OCC_WORDS; w++) {
+      __m256i vw = _mm256_set1_epi32(w);
+      __m256i c_here = _mm256_cmpeq_epi32(_mm256_srli_epi32(from, 5), vw);
+      __m256i s_here = _mm256_cmpeq_epi32(_mm256_srli_epi32(np, 5), vw);
+      __m256i bits = occ[w];
+      bits = _mm256_andnot_si256(_mm256_and_si256(c_here, clear_bit), bits);
+      bits = _mm256_or_si256(bits, _mm256_and_si256(s_here, set_bit));
+      _mm256_store_si256((__m256i *)(b->occ + w * lanes + l), bits);
+    }
+
+    __m256i turns = _mm256_load_si256((__m256i *)(b->turns + l));
+    turns = _mm256_sub_epi32(turns, live);
+    _mm256_store_si256((__m256i *)(b->turns + l), turns);
+    _mm256_store_si256((__m256i *)(b->cur + l),
+                       _mm256_blendv_epi8(c, next, live));
+
+    __m256i fin = _mm256_and_si256(ok, _mm256_cmpeq_epi32(np, finish));
+    act = _mm256_add_epi32(act, fin);
+    _mm256_store_si256((__m256i *)(b->active + l), act);
+
+    __m256i first = _mm256_load_si256((__m256i *)(b->first_turn + l));
+    __m256i winner = _mm256_load_si256((__m256i *)(b->winner + l));
+    __m256i won = _mm256_and_si256(fin, _mm256_cmpeq_epi32(first, zero));
+    _mm256_store_si256((__m256i *)(b->first_turn + l),
+                       _mm256_blendv_epi8(first, turns, won));
+    _mm256_store_si256((__m256i *)(b->winner + l),
+                       _mm256_blendv_epi8(winner, next, won));
+
+    __m256i over = _mm256_and_si256(live, _mm256_cmpeq_epi32(act, zero));
+    unsigned mask = _mm256_movemask_ps(_mm256_castsi256_ps(over));
+    while (mask) {
+      done[ndone++] = l + __builtin_ctz(mask);
+      mask &= mask - 1;
+    }
+  }
+  return ndone;
+}
+
+static step_fn step_impl = step_scalar;
+static const char *step_name = "scalar";
+
+int batch_select(const char *name) {
+  __builtin_cpu_init();
+  if (strcmp(name, "avx2") == 0 && __builtin_cpu_supports("avx2"))
+    step_impl = step_avx2;
+  else if (strcmp(name, "scalar") == 0)
+    step_impl = step_scalar;
+  else
+    return -1;
+  step_name = name;
+  return 0;
+}
+
+__attribute__((constructor)) static void batch_dispatch_init() {
+  if (batch_select("avx2") < 0)
+    batch_select("scalar");
+}
+
+const char *batch_name() { return step_name; }
+
+// play a range of games to completion, keeping every lane busy until the
+// last ones; lengths[id - first] gets each game's length if not NULL
+void batch_run(struct batch *b, const struct sim_range *range,
+               int32_t *lengths, struct sim_result *res) {
+  int32_t *done = malloc(b->lanes * sizeof(int32_t));
+  long running = 0;
+  long end = range->first + range->count;
+  b->range = *range;
+  b->next_game = range->first;
+
+  for (int lane = 0; lane < b->lanes; lane++) {
+    if (b->next_game < end) {
+      lane_reset(b, lane);
+      running++;
+    } else {
+      b->active[lane] = 0;
+    }
+  }
+
+  while (running > 0) {
+    int ndone = step_impl(b, done);
+    for (int i = 0; i < ndone; i++) {
+      int lane = done[i];
+      int len = b->turns[lane];
+      res->games++;
+      res->turns += len;
+      res->len_sq += (double)len * len;
+      res->win_turns += b->first_turn[lane];
+      res->win_sq += (double)b->first_turn[lane] * b->first_turn[lane];
+      res->wins[b->winner[lane]]++;
+      if (lengths != NULL)
+        lengths[b->game[lane] - range->first] = len;
+
+      if (b->next_game < end)
+        lane_reset(b, lane);
+      else
+        running--;
+    }
+  }
+  free(done);
+}
+
+struct batch_job {
+  const int *board;
+  int num_players;
+  int lanes;
+  struct sim_range range;
+  int32_t *lengths;
+  struct sim_result res;
+  int ok; // the whole range was played
+};
+
+static void *batch_thread(void *arg) {
+  struct batch_job *job = arg;
+  struct batch b;
+  if (batch_init(&b, job->board, job->num_players, job->lanes) < 0) {
+    fprintf(stderr, "batch: no memory for %d lanes, games %ld-%ld lost\n",
+            job->lanes, job->range.first,
+            job->range.first + job->range.count - 1);
+    return NULL;
+  }
+  batch_run(&b, &job->range, job->lengths, &job->res);
+  batch_free(&b);
+  job->ok = 1;
+  return NULL;
+}
+
+// split a range across threads; games keep their ids, and so their dice,
+// whichever thread plays them. Returns -1 unless every game was played;
+// lengths of the games that were not are left 0.
+int batch_simulate(const int *board, int num_players,
+                   const struct sim_range *range, int threads, int lanes,
+                   int32_t *lengths, struct sim_result *res) {
+  struct batch_job jobs[threads];
+  pthread_t tids[threads];
+  long first = range->first;
+  int started = threads, ok = 1;
+
+  if (lengths != NULL)
+    memset(lengths, 0, range->count * sizeof(*lengths));
+  for (int i = 0; i < threads; i++) {
+    long count = range->count / threads + (i < range->count % threads);
+    jobs[i].board = board;
+    jobs[i].num_players = num_players;
+    jobs[i].lanes = lanes;
+    jobs[i].range = *range;
+    jobs[i].range.first = first;
+    jobs[i].range.count = count;
+    jobs[i].lengths = lengths ? lengths + (first - range->first) : NULL;
+    memset(&jobs[i].res, 0, sizeof(jobs[i].res));
+    jobs[i].ok = 0;
+    first += count;
+    if (pthread_create(&tids[i], NULL, batch_thread, &jobs[i]) != 0) {
+      perror("pthread_create");
+      started = i;
+      break;
+    }
+  }
+  for (int i = 0; i < started; i++) {
+    pthread_join(tids[i], NULL);
+    sim_result_merge(res, &jobs[i].res);
+    ok &= jobs[i].ok;
+  }
+  return started == threads && ok ? 0 : -1;
+}
@@ -0,0 +1,81 @@
+/*
+ * batch.h - Structure-of-arrays simulator for many games at once
+ * CS39002 Operating Systems Laboratory
+ *
+ * Holds positions, turn pointers and RNG state for a batch of independent
+ * games, one lane per game, and advances every lane by one turn per step.
+ * The AVX2 step handles 8 games per vector: dice from a per-lane
+ * xorshift32 seeded from the game's stream in rng.h, board jumps through
+ * gathers, and the sixes, overshoot and occupancy rules as masks. A
+ * scalar step with the same arithmetic is the fallback and the reference.
+ *
+ * Author: Ashutosh Sharma
+ * Roll: 23CS10005
+ */
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdint.h>
+
+#include "engine.h"
+
+#define BATCH_WIDTH 8 // lanes per AVX2 vector
+#define OCC_WORDS 4   // 32-bit words in a lane's occupancy bitmap (cells 0-127)
+
+// what a set of finished games looked like
+struct sim_result {
+  uint64_t games;
+  uint64_t turns;          // sum of game lengths (until everyone finished)
+  double len_sq;           // sum of squared game lengths
+  uint64_t win_turns;      // sum of turns until the first player finished
+  double win_sq;
+  uint64_t wins[MAX_PLAYERS]; // first finisher by seat
+};
+
+// games first .. first + count - 1, game id on stream id of seed
+struct sim_range {
+  uint64_t seed;
+  long first;
+  long count;
+  int antithetic; // game 2k+1 replays game 2k's stream as 7 - die
+};
+
+struct batch {
+  int lanes; // multiple of BATCH_WIDTH
+  int num_players;
+  int32_t *pos; // pos[player * lanes + lane]
+  int32_t *cur; // player who moved last, -1 at the start
+  int32_t *active;
+  int32_t *turns;
+  int32_t *first_turn; // turn on which the first player finished, 0 if none
+  int32_t *winner;
+  uint32_t *rng;
+  int32_t *flip; // -1 in lanes playing an antithetic game
+  long *game;    // id of the game in each lane
+  uint32_t *occ; // occ[word * lanes + lane], one bit per occupied cell
+  int32_t jump[BOARD_SIZE];  // board modifiers
+  int32_t steps[BOARD_SIZE]; // hops a chain starting on a cell can take
+  int32_t link[BOARD_SIZE];  // steps << 8 | jump as a byte, for one gather
+  int max_steps;
+  struct sim_range range;
+  long next_game; // next id to hand to a lane
+};
+
+int batch_init(struct batch *b, const int *board, int num_players,
+               int lanes);
+void batch_free(struct batch *b);
+void batch_run(struct batch *b, const struct sim_range *range,
+               int32_t *lengths, struct sim_result *res);
+void sim_result_merge(struct sim_result *into, const struct sim_result *from);
+
+// batch_run() on several threads, results merged into res
+int batch_simulate(const int *board, int num_players,
+                   const struct sim_range *range, int threads, int lanes,
+                   int32_t *lengths, struct sim_result *res);
+
+// step kernel in use; batch_select("scalar"|"avx2") forces one
+const char *batch_name();
+int batch_select(const char *name);
+
+#endif
@@ -0,0 +1,592 @@
+/*
+ * bench.c - Micro-benchmarks for Snake Ludo
+ * CS39002 Operating Systems Laboratory
+ *
+ * Usage: ludo-bench <name> [args...]
+ *
+ * Author: Ashutosh Sharma
+ * Roll: 23CS10005
+ */
+
+#include <getopt.h>
+#include <math.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "affinity.h"
+#include "board_gen.h"
+#include "coro.h"
+#include "engine.h"
+#include "futex.h"
+#include "shm.h"
+#include "simd.h"
+#include "state.h"
+
+uint64_t rng_next_bench(uint64_t *state) {
+  *state ^= *state << 13;
+  *state ^= *state >> 7;
+  *state ^= *state << 17;
+  return *state;
+}
+
+uint64_t now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// ring: player processes push move records, this process drains them
+int bench_ring(int argc, char *argv[]) {
+  int producers = argc > 1 ? atoi(argv[1]) : 4;
+  long events = argc > 2 ? atol(argv[2]) : 2000000;
+  if (producers < 1 || producers > MAX_PLAYERS || events < 1) {
+    fprintf(stderr, "Usage: ludo-bench ring [producers 1-%d] [events]\n",
+            MAX_PLAYERS);
+    return 1;
+  }
+
+  int fd = shm_segment_create("ludo-bench", sizeof(struct ludo_state), 0);
+  if (fd < 0)
+    return 1;
+  struct ludo_state *state =
+      (struct ludo_state *)shm_segment_map(fd, sizeof(struct ludo_state), 1);
+  if (state == NULL)
+    return 1;
+
+  // baseline: push and pop in one thread, no sharing
+  struct ring_cursor cursor = {0, 0};
+  struct move_record rec, out;
+  memset(&rec, 0, sizeof(rec));
+  uint64_t start = now_ns();
+  for (long i = 0; i < events; i++) {
+    rec.turn = i;
+    ring_push(&state->rings[0], &rec);
+    ring_pop(&state->rings[0], &cursor, &out);
+  }
+  uint64_t elapsed = now_ns() - start;
+  printf("ring single-thread : %6.1f M events/s (%.1f ns/event)\n",
+         events * 1e3 / elapsed, (double)elapsed / events);
+
+  memset(state, 0, sizeof(*state));
+  long per_producer = events / producers;
+  pid_t pids[MAX_PLAYERS];
+
+  start = now_ns();
+  for (int p = 0; p < producers; p++) {
+    pids[p] = fork();
+    if (pids[p] < 0) {
+      perror("fork (producer)");
+      return 1;
+    }
+    if (pids[p] == 0) {
+      struct move_record r;
+      memset(&r, 0, sizeof(r));
+      r.player = p;
+      for (long i = 0; i < per_producer; i++) {
+        while (ring_space(&state->rings[p]) == 0)
+          sched_yield(); // consumer is behind, never overwrite in the bench
+        r.turn = i;
+        ring_push(&state->rings[p], &r);
+      }
+      _exit(0);
+    }
+  }
+
+  struct ring_cursor cursors[MAX_PLAYERS];
+  memset(cursors, 0, sizeof(cursors));
+  long consumed = 0, dropped = 0;
+  while (consumed < per_producer * producers) {
+    int got = 0;
+    for (int p = 0; p < producers; p++) {
+      while (ring_pop(&state->rings[p], &cursors[p], &out)) {
+        consumed++;
+        got++;
+      }
+      atomic_store_explicit(&state->rings[p].gate, cursors[p].next,
+                            memory_order_release);
+    }
+    if (!got)
+      sched_yield();
+  }
+  elapsed = now_ns() - start;
+
+  for (int p = 0; p < producers; p++) {
+    waitpid(pids[p], NULL, 0);
+    dropped += cursors[p].dropped;
+  }
+  printf("ring %2d producers   : %6.1f M events/s (%ld events, %ld dropped)\n",
+         producers, consumed * 1e3 / elapsed, consumed, dropped);
+
+  munmap(state, sizeof(*state));
+  close(fd);
+  return 0;
+}
+
+// where each stage of the turn handoff runs
+struct sched_config {
+  const char *cp, *pp, *players, *bp;
+  int fifo;
+};
+
+// BP stand-in: drain the ring, publish the turn as rendered
+void latency_bp(struct ludo_state *state, int turns, struct sched_config *cfg) {
+  sched_setup("BP", cfg->bp, cfg->fifo);
+  struct ring_cursor cursor = {0, 0};
+  struct move_record rec;
+  uint32_t seen = 0, last = 0;
+
+  while (last < (uint32_t)turns) {
+    uint32_t now = atomic_load_explicit(&state->events, memory_order_acquire);
+    if (now == seen) {
+      futex_wait(&state->events, seen, 100);
+      continue;
+    }
+    seen = now;
+    while (ring_pop(&state->rings[0], &cursor, &rec))
+      last = rec.turn;
+    atomic_store_explicit(&state->rendered, last, memory_order_release);
+    futex_wake(&state->rendered);
+  }
+  _exit(0);
+}
+
+// PP and player stand-ins: forward the signal, push a record
+void latency_pp(struct ludo_state *state, int turns, struct sched_config *cfg) {
+  sigset_t set;
+  sigemptyset(&set);
+  sigaddset(&set, SIGUSR1);
+
+  pid_t player = fork();
+  if (player == 0) {
+    sched_setup("PLAYERS", cfg->players, cfg->fifo);
+    struct move_record rec;
+    memset(&rec, 0, sizeof(rec));
+    for (int t = 0; t < turns; t++) {
+      sigwaitinfo(&set, NULL);
+      rec.turn = atomic_load_explicit(&state->turn, memory_order_acquire);
+      ring_push(&state->rings[0], &rec);
+      atomic_fetch_add_explicit(&state->events, 1, memory_order_release);
+      futex_wake(&state->events);
+    }
+    _exit(0);
+  }
+
+  sched_setup("PP", cfg->pp, cfg->fifo);
+  for (int t = 0; t < turns; t++) {
+    sigwaitinfo(&set, NULL);
+    kill(player, SIGUSR1);
+  }
+  waitpid(player, NULL, 0);
+  _exit(0);
+}
+
+// CP stand-in: time turns, one latency sample (ns) per turn into lat
+void latency_cp(uint64_t *lat, int turns, struct sched_config *cfg) {
+  int fd = shm_segment_create("ludo-bench", sizeof(struct ludo_state), 0);
+  if (fd < 0)
+    _exit(1);
+  struct ludo_state *state =
+      (struct ludo_state *)shm_segment_map(fd, sizeof(struct ludo_state), 1);
+  if (state == NULL)
+    _exit(1);
+
+  // children inherit the blocked mask, so no early signal is lost
+  sigset_t set;
+  sigemptyset(&set);
+  sigaddset(&set, SIGUSR1);
+  sigprocmask(SIG_BLOCK, &set, NULL);
+
+  pid_t bp = fork();
+  if (bp == 0)
+    latency_bp(state, turns, cfg);
+  pid_t pp = fork();
+  if (pp == 0)
+    latency_pp(state, turns, cfg);
+
+  sched_setup("CP", cfg->cp, cfg->fifo);
+  usleep(100000);
+
+  for (int t = 1; t <= turns; t++) {
+    uint64_t start = now_ns();
+    atomic_store_explicit(&state->turn, t, memory_order_release);
+    kill(pp, SIGUSR1);
+
+    uint32_t rendered;
+    uint32_t turn = t;
+    while ((rendered = atomic_load_explicit(&state->rendered,
+                                            memory_order_acquire)) < turn)
+      futex_wait(&state->rendered, rendered, 100);
+    lat[t - 1] = now_ns() - start;
+  }
+
+  waitpid(bp, NULL, 0);
+  waitpid(pp, NULL, 0);
+  _exit(0);
+}
+
+int compare_u64(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+  return x < y ? -1 : x > y;
+}
+
+// run the handoff chain in a fresh process tree, print percentiles
+// (in a child, so pinning one run does not leak into the next)
+int latency_run(const char *label, int turns, struct sched_config *cfg,
+                uint64_t *p50) {
+  uint64_t *lat = mmap(NULL, turns * sizeof(uint64_t), PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (lat == MAP_FAILED) {
+    perror("mmap (latencies)");
+    return -1;
+  }
+
+  pid_t cp = fork();
+  if (cp == 0)
+    latency_cp(lat, turns, cfg);
+  int status;
+  waitpid(cp, &status, 0);
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    fprintf(stderr, "latency run '%s' failed\n", label);
+    return -1;
+  }
+
+  qsort(lat, turns, sizeof(uint64_t), compare_u64);
+  uint64_t sum = 0;
+  for (int i = 0; i < turns; i++)
+    sum += lat[i];
+  printf("%-8s: mean %7.1f us  p50 %7.1f  p90 %7.1f  p99 %7.1f  max %8.1f\n",
+         label, sum / 1e3 / turns, lat[turns / 2] / 1e3,
+         lat[turns * 9 / 10] / 1e3, lat[turns * 99 / 100] / 1e3,
+         lat[turns - 1] / 1e3);
+  *p50 = lat[turns / 2];
+  munmap(lat, turns * sizeof(uint64_t));
+  return 0;
+}
+
+// latency: CP -> PP -> player -> ring -> BP -> CP round trip per turn
+int bench_latency(int argc, char *argv[]) {
+  int turns = 20000;
+  struct sched_config pinned = {NULL, NULL, NULL, NULL, 0};
+  int opt;
+
+  while ((opt = getopt(argc, argv, "n:c:p:y:b:f:")) != -1) {
+    switch (opt) {
+    case 'n':
+      turns = atoi(optarg);
+      break;
+    case 'c':
+      pinned.cp = optarg;
+      break;
+    case 'p':
+      pinned.pp = optarg;
+      break;
+    case 'y':
+      pinned.players = optarg;
+      break;
+    case 'b':
+      pinned.bp = optarg;
+      break;
+    case 'f':
+      pinned.fifo = atoi(optarg);
+      break;
+    default:
+      fprintf(stderr, "Usage: ludo-bench latency [-n turns] [-c cpus] "
+                      "[-p cpus] [-y cpus] [-b cpus] [-f prio]\n");
+      return 1;
+    }
+  }
+  if (turns < 100)
+    turns = 100;
+
+  struct sched_config cfs = {NULL, NULL, NULL, NULL, 0};
+  uint64_t base, tuned;
+  printf("turn handoff latency over %d turns\n", turns);
+  if (latency_run("default", turns, &cfs, &base) < 0)
+    return 1;
+
+  if (!pinned.cp && !pinned.pp && !pinned.players && !pinned.bp &&
+      !pinned.fifo)
+    return 0;
+  if (latency_run("pinned", turns, &pinned, &tuned) < 0)
+    return 1;
+  printf("p50 change: %+.1f%%\n", (double)tuned * 100.0 / base - 100.0);
+  return 0;
+}
+
+// occupancy: occ_any and occ_next_active per kernel at several sizes
+int bench_occupancy(int argc, char *argv[]) {
+  static const int sizes[] = {64, 1024, 65536};
+  static const char *isas[] = {"scalar", "sse4", "avx2"};
+  const char *best = simd_name();
+
+  printf("%-7s %-7s %12s %12s %9s\n", "tokens", "kernel", "occ_any ns",
+         "next ns", "speedup");
+  for (int s = 0; s < 3; s++) {
+    int n = sizes[s];
+    uint16_t *pos = malloc(n * sizeof(uint16_t));
+    uint16_t *done = malloc(n * sizeof(uint16_t));
+    uint64_t rng = 12345;
+    for (int i = 0; i < n; i++) {
+      pos[i] = 1 + rng_next_bench(&rng) % 98; // never on cell 99
+      done[i] = FINISH_CELL;                  // late game: all but one done
+    }
+    done[n - 1] = 50;
+
+    long calls = (1L << 26) / n;
+    double scalar_ns = 0;
+    for (int k = 0; k < 3; k++) {
+      if (simd_select(isas[k]) < 0)
+        continue;
+
+      volatile int sink = 0;
+      uint64_t start = now_ns();
+      for (long c = 0; c < calls; c++)
+        sink += occ_any(pos, n, 99, c % n);
+      double any_ns = (double)(now_ns() - start) / calls;
+
+      start = now_ns();
+      for (long c = 0; c < calls; c++)
+        sink += occ_next_active(done, n, -1, FINISH_CELL);
+      double next_ns = (double)(now_ns() - start) / calls;
+
+      if (k == 0)
+        scalar_ns = any_ns + next_ns;
+      printf("%-7d %-7s %12.1f %12.1f %8.1fx\n", n, isas[k], any_ns, next_ns,
+             scalar_ns / (any_ns + next_ns));
+      (void)sink;
+    }
+    free(pos);
+    free(done);
+  }
+  simd_select(best);
+  return 0;
+}
+
+// tasks: cost of resuming player coroutines round-robin, as the PP does
+// with --player-tasks
+struct bench_task {
+  struct coro co;
+  int idx;
+  uint32_t turns;
+  uint64_t dice;
+};
+
+// kept out of line so each turn pays for a real call, as in players.c
+__attribute__((noinline)) int bench_task_run(struct bench_task *task) {
+  CORO_BEGIN(&task->co);
+  while (1) {
+    CORO_YIELD(&task->co);
+    task->turns++;
+    task->dice ^= task->dice << 13;
+  }
+  CORO_END(&task->co);
+}
+
+int bench_tasks(int argc, char *argv[]) {
+  int n = argc > 1 ? atoi(argv[1]) : 10000;
+  long turns = argc > 2 ? atol(argv[2]) : 100000000;
+  if (n < 1 || turns < n) {
+    fprintf(stderr, "tasks: need 1 or more tasks and at least one turn "
+                    "each\n");
+    return 1;
+  }
+
+  struct bench_task *tasks = calloc(n, sizeof(*tasks));
+  if (tasks == NULL) {
+    perror("calloc");
+    return 1;
+  }
+  for (int i = 0; i < n; i++) {
+    tasks[i].idx = i;
+    tasks[i].dice = i + 1;
+    bench_task_run(&tasks[i]);
+  }
+
+  int cur = -1;
+  uint64_t start = now_ns();
+  for (long t = 0; t < turns; t++) {
+    cur = cur + 1 < n ? cur + 1 : 0;
+    bench_task_run(&tasks[cur]);
+  }
+  double ns = (double)(now_ns() - start) / turns;
+
+  uint64_t played = 0;
+  for (int i = 0; i < n; i++)
+    played += tasks[i].turns;
+  printf("%d tasks, %zu bytes each (%.1f KB), %lu turns\n", n,
+         sizeof(struct bench_task), n * sizeof(struct bench_task) / 1024.0,
+         played);
+  printf("resume + yield: %.2f ns per turn\n", ns);
+  free(tasks);
+  return 0;
+}
+
+// dice: a turn's roll die by die against one alias table draw
+int bench_dice(int argc, char *argv[]) {
+  long rolls = argc > 1 ? atol(argv[1]) : 100000000;
+  uint64_t rng = 1;
+  struct turn t;
+  volatile int sink = 0;
+
+  uint64_t start = now_ns();
+  for (long i = 0; i < rolls; i++)
+    sink += game_roll(&rng, &t);
+  double loop_ns = (double)(now_ns() - start) / rolls;
+
+  start = now_ns();
+  for (long i = 0; i < rolls; i++)
+    sink += game_roll_alias(&rng, &t);
+  double alias_ns = (double)(now_ns() - start) / rolls;
+
+  // outcome o is o / 5 sixes then o % 5 + 1, 15 is three sixes
+  long seen[DICE_OUTCOMES] = {0};
+  for (long i = 0; i < rolls; i++) {
+    game_roll_alias(&rng, &t);
+    int last = t.dice[t.ndice - 1];
+    seen[last == 6 ? 15 : (t.ndice - 1) * 5 + last - 1]++;
+  }
+  double worst = 0;
+  for (int o = 0; o < DICE_OUTCOMES; o++) {
+    double expect = rolls * (o < 5 ? 36 : o < 10 ? 6 : 1) / 216.0;
+    double off = fabs(seen[o] - expect) / expect;
+    if (off > worst)
+      worst = off;
+  }
+
+  printf("die by die  %6.2f ns per turn\n", loop_ns);
+  printf("alias draw  %6.2f ns per turn (%.1fx)\n", alias_ns,
+         loop_ns / alias_ns);
+  printf("largest outcome frequency error %.3f%%\n", worst * 100);
+  (void)sink;
+  return 0;
+}
+
+// rules: games per second of each variant's own turn function against
+// the same turn with its rules checked at run time
+int bench_rules(int argc, char *argv[]) {
+  long games = argc > 1 ? atol(argv[1]) : 100000;
+  int board[BOARD_SIZE];
+  if (board_load(board, "ludo.txt") < 0)
+    return 1;
+
+  printf("%-10s %12s %12s %10s %11s\n", "variant", "games/s", "checked/s",
+         "speedup", "turns/game");
+  for (int v = 0; v < num_rules_variants; v++) {
+    const struct rules_variant *rv = &rules_variants[v];
+    struct game g;
+    struct turn t;
+    uint64_t turns = 0;
+
+    uint64_t start = now_ns();
+    for (long i = 0; i < games; i++) {
+      game_init(&g, 4, rng_stream(1, i));
+      while (rv->turn(board, &g, &t) == 0)
+        ;
+      turns += g.turns;
+    }
+    double fixed = games * 1e9 / (now_ns() - start);
+
+    start = now_ns();
+    for (long i = 0; i < games; i++) {
+      game_init(&g, 4, rng_stream(1, i));
+      while (game_turn_rules(board, &g, &t, &rv->rules) == 0)
+        ;
+    }
+    double checked = games * 1e9 / (now_ns() - start);
+
+    printf("%-10s %12.0f %12.0f %9.2fx %11.2f\n", rv->name, fixed, checked,
+           fixed / checked, (double)turns / games);
+  }
+  return 0;
+}
+
+// codegen: game_turn() on the board array against game_turn_gen() on the
+// board compiled into board_gen.h; both play the same games
+int bench_codegen(int argc, char *argv[]) {
+  long games = argc > 1 ? atol(argv[1]) : 200000;
+  int board[BOARD_SIZE];
+  if (board_load(board, GEN_BOARD_FILE) < 0)
+    return 1;
+  for (int i = 0; i < BOARD_SIZE; i++) {
+    if (board[i] != gen_jump[i]) {
+      fprintf(stderr, "codegen: %s changed since board_gen.h was made\n",
+              GEN_BOARD_FILE);
+      return 1;
+    }
+  }
+
+  turn_fn turns[2] = {game_turn, game_turn_gen};
+  const char *names[2] = {"table", "generated"};
+  uint64_t played[2] = {0, 0};
+  double rate[2];
+
+  printf("%-10s %12s %11s\n", "engine", "games/s", "turns/game");
+  for (int k = 0; k < 2; k++) {
+    struct game g;
+    struct turn t;
+    uint64_t start = now_ns();
+    for (long i = 0; i < games; i++) {
+      game_init(&g, 4, rng_stream(1, i));
+      while (turns[k](board, &g, &t) == 0)
+        ;
+      played[k] += g.turns;
+    }
+    rate[k] = games * 1e9 / (now_ns() - start);
+    printf("%-10s %12.0f %11.2f\n", names[k], rate[k],
+           (double)played[k] / games);
+  }
+  printf("speedup %.2fx, %s\n", rate[1] / rate[0],
+         played[0] == played[1] ? "same games" : "GAMES DIFFER");
+  return played[0] != played[1];
+}
+
+struct benchmark {
+  const char *name;
+  const char *help;
+  int (*run)(int argc, char *argv[]);
+};
+
+struct benchmark benchmarks[] = {
+    {"ring", "[producers] [events]  move record ring throughput", bench_ring},
+    {"latency", "[-n turns] [-c|-p|-y|-b cpus] [-f prio]  turn handoff",
+     bench_latency},
+    {"occupancy", "scalar vs SSE4 vs AVX2 position scans", bench_occupancy},
+    {"tasks", "[tasks] [turns]  player coroutine switch cost", bench_tasks},
+    {"dice", "[rolls]  dice loop vs alias table draw", bench_dice},
+    {"rules", "[games]  compiled vs run-time checked rules variants",
+     bench_rules},
+    {"codegen", "[games]  board table vs board compiled by ludo-gen",
+     bench_codegen},
+};
+
+#define NUM_BENCHMARKS (int)(sizeof(benchmarks) / sizeof(benchmarks[0]))
+
+void print_usage(char *prog_name) {
+  printf("Usage: %s <benchmark> [args...]\n", prog_name);
+  for (int i = 0; i < NUM_BENCHMARKS; i++)
+    printf("  %-10s %s\n", benchmarks[i].name, benchmarks[i].help);
+  printf("\nlatency CPU lists: CP (-c), PP (-p), players (-y), BP (-b)\n");
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    print_usage(argv[0]);
+    return 1;
+  }
+
+  for (int i = 0; i < NUM_BENCHMARKS; i++) {
+    if (strcmp(argv[1], benchmarks[i].name) == 0)
+      return benchmarks[i].run(argc - 1, argv + 1);
+  }
+
+  fprintf(stderr, "Unknown benchmark '%s'\n", argv[1]);
+  print_usage(argv[0]);
+  return 1;
+}
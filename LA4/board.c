@@ -2,39 +2,70 @@
  * board.c - Board Process (BP) for Snake Ludo
  * CS39002 Operating Systems Laboratory
  *
- * This process displays the game board, updating on SIGUSR1 signals.
- * Sends acknowledgment to CP after each board print via pipe.
+ * This process displays the game board, updating whenever a player
+ * publishes a move record (or on SIGUSR1). After each redraw it publishes
+ * the last turn drawn, which the CP waits on instead of a pipe ACK.
  * Terminates on SIGUSR2 from the coordinator.
  *
+ * board --attach [pid] is a spectator: it maps a running game read-only
+ * and redraws whenever the BP has, following the frames counter. It
+ * never writes to the game, so the CP and the players never wait on it,
+ * and it runs under SCHED_IDLE at a capped frame rate so that a crowd of
+ * them does not take CPU time from the turn path either.
+ *
+ * With LUDO_ODDS set (ludo --odds) the board also shows each active
+ * player's chance to finish next and expected rank, estimated by
+ * rollout threads in odds.c. The panel reads whatever estimate is there
+ * when the board is drawn and is refreshed in place while the BP is
+ * idle, so it never holds up a redraw or the ACK.
+ *
  * Author: Ashutosh Sharma
  * Roll: 23CS10005
  */
 
+#define _GNU_SOURCE // SCHED_IDLE
+
 #include <fcntl.h>
+#include <sched.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/ipc.h>
-#include <sys/shm.h>
+#include <sys/mman.h>
 #include <sys/types.h>
 #include <unistd.h>
 
-#define BOARD_SIZE 101
-#define MAX_PLAYERS 26
+#include "affinity.h"
+#include "futex.h"
+#include "odds.h"
+#include "shm.h"
+#include "state.h"
+#include "trace.h"
+
+#define SPECTATOR_FRAME_MS 33 // spectators redraw at most ~30 times a second
+#define ODDS_ROW 17           // screen line of the odds panel
+#define ODDS_PER_LINE 4
+#define ODDS_REFRESH_MS 250
 
 // Global variables
 int *shm_board = NULL;
 int *shm_players = NULL;
+struct ludo_state *shm_state = NULL;
+struct ring_cursor cursors[MAX_PLAYERS];
+size_t board_bytes = 0;
+size_t players_bytes = 0;
 int num_players = 0;
 int pipe_fd = -1; // write end of pipe to CP
 volatile sig_atomic_t should_redraw = 1;
 volatile sig_atomic_t should_exit = 0;
+uint32_t drawn = 0; // last turn drawn
+int show_odds = 0;
 
 const char player_symbols[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
 
 void sigusr1_handler(int sig) { should_redraw = 1; }
 void sigusr2_handler(int sig) { should_exit = 1; }
+void sigint_handler(int sig) { should_exit = 1; }
 
 // get cell number for board position (zigzag pattern)
 // row 0 is top (cells 91-100), row 9 is bottom (cells 1-10)
@@ -65,6 +96,104 @@ void send_ack() {
   write(pipe_fd, ack, strlen(ack));
 }
 
+// start reading every player's ring from its current head
+void init_cursors() {
+  for (int i = 0; i < num_players; i++) {
+    cursors[i].next = atomic_load(&shm_state->rings[i].head);
+    cursors[i].dropped = 0;
+  }
+}
+
+// consume new move records, returns the latest turn seen (0 if none)
+uint32_t drain_moves() {
+  uint32_t last = 0;
+  struct move_record rec;
+
+  for (int i = 0; i < num_players; i++) {
+    while (ring_pop(&shm_state->rings[i], &cursors[i], &rec)) {
+      if (rec.turn > last)
+        last = rec.turn;
+    }
+    atomic_store_explicit(&shm_state->rings[i].gate, cursors[i].next,
+                          memory_order_release);
+  }
+  return last;
+}
+
+// a turn in the middle of a next N batch that is not to be drawn; with
+// render_every set, the first turn drained past each multiple of it is
+int skip_redraw(uint32_t turn) {
+  uint32_t end = atomic_load_explicit(&shm_state->batch_end,
+                                      memory_order_acquire);
+  uint32_t every = shm_state->render_every;
+  if (turn >= end || shm_players[num_players] <= 0)
+    return 0;
+  return every == 0 || turn / every == drawn / every;
+}
+
+// tell the CP the board now shows this turn, then the spectators; they
+// wait on their own word so the CP is never queued behind them
+void publish_rendered(uint32_t turn) {
+  atomic_store_explicit(&shm_state->rendered, turn, memory_order_release);
+  futex_wake(&shm_state->rendered);
+  atomic_fetch_add_explicit(&shm_state->frames, 1, memory_order_release);
+  futex_wake(&shm_state->frames);
+}
+
+// odds panel: a header line, then ODDS_PER_LINE players to a line
+void print_odds(const struct odds *o, int have) {
+  char line[80];
+
+  if (have)
+    snprintf(line, sizeof(line),
+             "Odds from %ld rollouts: next to finish, expected rank",
+             o->games);
+  else
+    snprintf(line, sizeof(line), "Odds: estimating...");
+  printf("|  %-70s|\n", line);
+
+  for (int i = 0; i < num_players; i += ODDS_PER_LINE) {
+    printf("| ");
+    for (int p = i; p < i + ODDS_PER_LINE; p++) {
+      if (p >= num_players)
+        printf("%17s", "");
+      else if (shm_players[p] == 100)
+        printf(" %c %-14s", player_symbols[p], "finished");
+      else if (have)
+        printf(" %c %5.1f%% %5.2f  ", player_symbols[p],
+               100.0 * o->first[p], o->rank[p]);
+      else
+        printf(" %c %-14s", player_symbols[p], "--");
+    }
+    printf("   |\n");
+  }
+}
+
+// redraw just the odds panel if the estimate has moved on, leaving the
+// cursor where it was
+void refresh_odds() {
+  static uint64_t last_ns = 0;
+  static long last_games = -1;
+  static uint32_t last_events = 0;
+  struct odds o;
+
+  uint64_t now = stat_now_ns();
+  if (now - last_ns < ODDS_REFRESH_MS * 1000000ULL)
+    return;
+  last_ns = now;
+
+  int have = odds_read(&o);
+  if (o.games == last_games && o.events == last_events)
+    return;
+  last_games = o.games;
+  last_events = o.events;
+
+  printf("\0337\033[%d;1H", ODDS_ROW);
+  print_odds(&o, have);
+  printf("\0338");
+  fflush(stdout);
+}
+
 void print_board() {
   printf("\033[2J\033[H");
 
@@ -153,6 +282,12 @@ void print_board() {
     printf(" ");
   printf("|\n");
 
+  if (show_odds) {
+    struct odds o;
+    int have = odds_read(&o);
+    print_odds(&o, have);
+  }
+
   printf("+");
   for (int i = 0; i < 72; i++)
     printf("-");
@@ -165,20 +300,91 @@ void print_board() {
   fflush(stdout);
 }
 
+// map a segment of the game run by pid read-only
+void *attach_segment(pid_t *pid, const char *name, size_t *bytes) {
+  char path[SHM_PATH_LEN];
+  pid_t owner = shm_segment_find(*pid, name, path);
+  if (owner < 0) {
+    fprintf(stderr, "No running game found%s\n", *pid ? " for that PID" : "");
+    return NULL;
+  }
+  *pid = owner;
+
+  int fd = shm_segment_open(path, 0, bytes);
+  if (fd < 0)
+    return NULL;
+  void *addr = shm_segment_map(fd, *bytes, 0);
+  close(fd);
+  return addr;
+}
+
+// spectator: follow the BP's redraws until the game or the viewer quits
+int spectate(pid_t pid) {
+  struct sched_param param = {0};
+  if (sched_setscheduler(0, SCHED_IDLE, &param) < 0)
+    perror("sched_setscheduler (SCHED_IDLE)");
+
+  shm_state = attach_segment(&pid, "ludo-players", &players_bytes);
+  if (shm_state == NULL)
+    return 1;
+  if (players_bytes != sizeof(struct ludo_state)) {
+    fprintf(stderr, "Game %d uses a different state layout\n", pid);
+    return 1;
+  }
+  shm_board = attach_segment(&pid, "ludo-board", &board_bytes);
+  if (shm_board == NULL)
+    return 1;
+  shm_players = shm_state->players;
+  num_players = shm_state->num_players;
+
+  signal(SIGINT, sigint_handler);
+
+  struct timespec frame = {0, SPECTATOR_FRAME_MS * 1000000L};
+  uint32_t seen = atomic_load_explicit(&shm_state->frames,
+                                       memory_order_acquire);
+  int redraw = 1;
+  while (!should_exit) {
+    if (redraw) {
+      print_board();
+      printf("  Watching game %d at turn %u (Ctrl-C to leave)\n", pid,
+             atomic_load_explicit(&shm_state->rendered,
+                                  memory_order_relaxed));
+      fflush(stdout);
+      nanosleep(&frame, NULL); // later redraws fold into the next one
+    }
+    futex_wait(&shm_state->frames, seen, 1000);
+    uint32_t now = atomic_load_explicit(&shm_state->frames,
+                                        memory_order_acquire);
+    redraw = now != seen;
+    seen = now;
+    if (!redraw && kill(pid, 0) < 0)
+      break; // the game is over and the CP gone
+  }
+
+  printf("\n+++ Spectator: left game %d\n", pid);
+  munmap(shm_board, board_bytes);
+  munmap(shm_state, players_bytes);
+  return 0;
+}
+
 int main(int argc, char *argv[]) {
+  if (argc >= 2 && strcmp(argv[1], "--attach") == 0)
+    return spectate(argc >= 3 ? atoi(argv[2]) : 0);
+
   if (argc < 5) {
     fprintf(
         stderr,
-        "Usage: %s <shm_board_id> <shm_players_id> <num_players> <pipe_fd>\n",
-        argv[0]);
+        "Usage: %s <shm_board_path> <shm_players_path> <num_players> <fifo>\n"
+        "       %s --attach [pid]\n",
+        argv[0], argv[0]);
     return 1;
   }
 
-  int shm_id_board = atoi(argv[1]);
-  int shm_id_players = atoi(argv[2]);
   num_players = atoi(argv[3]);
   const char *fifo_path = argv[4];
 
+  sched_setup_from_env("BP");
+
   // open fifo for writing to CP
   pipe_fd = open(fifo_path, O_WRONLY);
   if (pipe_fd < 0) {
@@ -186,17 +392,26 @@ int main(int argc, char *argv[]) {
     return 1;
   }
 
-  shm_board = (int *)shmat(shm_id_board, NULL, SHM_RDONLY);
-  if (shm_board == (int *)-1) {
-    perror("shmat (board)");
+  // the board segment is sealed, so it can only be mapped read-only
+  int fd = shm_segment_open(argv[1], 0, &board_bytes);
+  if (fd < 0)
+    return 1;
+  shm_board = (int *)shm_segment_map(fd, board_bytes, 0);
+  close(fd);
+  if (shm_board == NULL)
     return 1;
-  }
 
-  shm_players = (int *)shmat(shm_id_players, NULL, 0);
-  if (shm_players == (int *)-1) {
-    perror("shmat (players)");
+  fd = shm_segment_open(argv[2], 1, &players_bytes);
+  if (fd < 0)
     return 1;
-  }
+  shm_state = (struct ludo_state *)shm_segment_map(fd, players_bytes, 1);
+  close(fd);
+  if (shm_state == NULL)
+    return 1;
+  shm_players = shm_state->players;
+  init_cursors();
+  trace_attach();
+  trace_claim(TRACE_BP);
 
   signal(SIGUSR1, sigusr1_handler);
   signal(SIGUSR2, sigusr2_handler);
@@ -205,27 +420,62 @@ int main(int argc, char *argv[]) {
   sprintf(pid_msg, "PID:%d\n", getpid());
   write(pipe_fd, pid_msg, strlen(pid_msg));
 
+  const char *odds_threads = getenv("LUDO_ODDS");
+  if (odds_threads != NULL) {
+    int threads = atoi(odds_threads);
+    show_odds = odds_start(shm_board, shm_state, num_players,
+                           threads > 0 ? threads : 1) == 0;
+  }
+
   sleep(1);
 
+  uint32_t seen = atomic_load(&shm_state->events);
   print_board();
-  send_ack();
+  send_ack(); // initial board, CP waits for it on the FIFO
   should_redraw = 0;
 
+  int idle = 0;
   while (!should_exit) {
-    if (should_redraw) {
-      should_redraw = 0;
-      print_board();
-      send_ack();
+    // sleep until a player publishes a move; wake up now and then for
+    // SIGUSR1/SIGUSR2 since the futex wait may be restarted
+    uint32_t now = atomic_load_explicit(&shm_state->events,
+                                        memory_order_acquire);
+    if (now == seen && !should_redraw) {
+      if (!idle)
+        trace(TRACE_BP, TRACE_WAIT, TRACE_BEGIN, drawn);
+      idle = 1;
+      if (show_odds)
+        refresh_odds();
+      futex_wait(&shm_state->events, seen, 100);
+      continue;
     }
-
-    if (!should_exit) {
-      pause();
+    if (idle)
+      trace(TRACE_BP, TRACE_WAIT, TRACE_END, atomic_load(&shm_state->turn));
+    idle = 0;
+    seen = now;
+    should_redraw = 0;
+
+    uint64_t start = stat_now_ns();
+    uint32_t turn = drain_moves();
+    if (turn && skip_redraw(turn))
+      continue;
+    trace(TRACE_BP, TRACE_RENDER, TRACE_BEGIN, turn);
+    print_board();
+    stat_add(&shm_state->stats.redraws, 1);
+    stat_time(&shm_state->stats, STAGE_RENDER, stat_now_ns() - start);
+    trace(TRACE_BP, TRACE_RENDER, TRACE_END, turn);
+    if (turn) {
+      drawn = turn;
+      trace(TRACE_BP, TRACE_ACK, TRACE_MARK, turn);
+      publish_rendered(turn);
     }
   }
 
   printf("\n+++ BP: Board process terminating...\n");
-  shmdt(shm_board);
-  shmdt(shm_players);
+  if (show_odds)
+    odds_stop();
+  munmap(shm_board, board_bytes);
+  munmap(shm_state, players_bytes);
 
   return 0;
 }
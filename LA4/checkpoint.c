@@ -0,0 +1,165 @@
+/*
+ * checkpoint.c - Game checkpoints for the coordinator
+ * CS39002 Operating Systems Laboratory
+ *
+ * The CP calls checkpoint_save() between turns, when no process is
+ * changing the game, and it only copies a few KB into a pending buffer.
+ * A writer thread picks the buffer up and does the slow part: write to
+ * <path>.tmp, fsync, and rename over <path>, so the file on disk is always
+ * a whole checkpoint. If the writer is still busy, the next save simply
+ * replaces the pending one; the turn loop never waits for the disk.
+ *
+ * Author: Ashutosh Sharma
+ * Roll: 23CS10005
+ */
+
+#include "checkpoint.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+static char c_path[256];
+static char c_tmp_path[260];
+static struct checkpoint c_pending; // guarded by c_lock
+static int c_has_pending = 0;
+static int c_stopping = 0;
+static int c_running = 0;
+static long c_written = 0;
+static long c_replaced = 0; // saves overtaken before they were written
+static pthread_mutex_t c_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t c_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t c_thread;
+
+static int write_file(const struct checkpoint *ck) {
+  int fd = open(c_tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    perror("open (checkpoint)");
+    return -1;
+  }
+  if (write(fd, ck, sizeof(*ck)) != sizeof(*ck) || fsync(fd) < 0) {
+    perror("write (checkpoint)");
+    close(fd);
+    unlink(c_tmp_path);
+    return -1;
+  }
+  close(fd);
+  if (rename(c_tmp_path, c_path) < 0) {
+    perror("rename (checkpoint)");
+    unlink(c_tmp_path);
+    return -1;
+  }
+  return 0;
+}
+
+static void *checkpoint_thread(void *arg) {
+  struct checkpoint ck;
+
+  pthread_mutex_lock(&c_lock);
+  while (1) {
+    while (!c_has_pending && !c_stopping)
+      pthread_cond_wait(&c_cond, &c_lock);
+    if (!c_has_pending)
+      break;
+    ck = c_pending;
+    c_has_pending = 0;
+    pthread_mutex_unlock(&c_lock);
+
+    int ok = write_file(&ck) == 0;
+
+    pthread_mutex_lock(&c_lock);
+    if (ok)
+      c_written++;
+  }
+  pthread_mutex_unlock(&c_lock);
+  return NULL;
+}
+
+int checkpoint_start(const char *path, const int *board, int num_players,
+                     uint64_t seed) {
+  snprintf(c_path, sizeof(c_path), "%s", path);
+  snprintf(c_tmp_path, sizeof(c_tmp_path), "%s.tmp", c_path);
+
+  memset(&c_pending, 0, sizeof(c_pending));
+  c_pending.magic = CHECKPOINT_MAGIC;
+  c_pending.version = CHECKPOINT_VERSION;
+  c_pending.size = sizeof(struct checkpoint);
+  c_pending.seed = seed;
+  c_pending.num_players = num_players;
+  memcpy(c_pending.board, board, sizeof(c_pending.board));
+
+  if (pthread_create(&c_thread, NULL, checkpoint_thread, NULL) != 0) {
+    perror("pthread_create (checkpoint)");
+    return -1;
+  }
+  c_running = 1;
+  return 0;
+}
+
+// call between turns only: then nothing else writes the state
+void checkpoint_save(const struct ludo_state *state) {
+  if (!c_running)
+    return;
+
+  pthread_mutex_lock(&c_lock);
+  if (c_has_pending)
+    c_replaced++;
+  memcpy(c_pending.players, state->players, sizeof(c_pending.players));
+  c_pending.turn = atomic_load(&state->turn);
+  c_pending.current = state->current;
+  memcpy(c_pending.dice, state->dice, sizeof(c_pending.dice));
+  memcpy(&c_pending.stats, &state->stats, sizeof(c_pending.stats));
+  c_pending.stats.turn_start_ns = 0;
+  c_has_pending = 1;
+  pthread_cond_signal(&c_cond);
+  pthread_mutex_unlock(&c_lock);
+}
+
+// writes whatever is still pending
+void checkpoint_stop() {
+  if (!c_running)
+    return;
+
+  pthread_mutex_lock(&c_lock);
+  c_stopping = 1;
+  pthread_cond_signal(&c_cond);
+  pthread_mutex_unlock(&c_lock);
+  pthread_join(c_thread, NULL);
+  c_running = 0;
+
+  printf("+++ CP: %ld checkpoints written to %s (%ld overtaken)\n", c_written,
+         c_path, c_replaced);
+}
+
+int checkpoint_load(const char *path, struct checkpoint *ck) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    perror("open (checkpoint)");
+    return -1;
+  }
+  ssize_t n = read(fd, ck, sizeof(*ck));
+  close(fd);
+
+  if (n != sizeof(*ck) || ck->magic != CHECKPOINT_MAGIC ||
+      ck->version != CHECKPOINT_VERSION || ck->size != sizeof(*ck)) {
+    fprintf(stderr, "Error: %s is not a checkpoint from this build\n", path);
+    return -1;
+  }
+  if (ck->num_players < 2 || ck->num_players > MAX_PLAYERS) {
+    fprintf(stderr, "Error: %s has a bad player count\n", path);
+    return -1;
+  }
+  return 0;
+}
+
+// put a checkpoint back into a fresh state segment
+void checkpoint_restore(const struct checkpoint *ck, struct ludo_state *state) {
+  memcpy(state->players, ck->players, sizeof(state->players));
+  atomic_store(&state->turn, ck->turn);
+  atomic_store(&state->rendered, ck->turn);
+  state->current = ck->current;
+  memcpy(state->dice, ck->dice, sizeof(state->dice));
+  memcpy(&state->stats, &ck->stats, sizeof(state->stats));
+}
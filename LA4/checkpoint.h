@@ -0,0 +1,43 @@
+/*
+ * checkpoint.h - Game checkpoints for the coordinator
+ * CS39002 Operating Systems Laboratory
+ *
+ * Author: Ashutosh Sharma
+ * Roll: 23CS10005
+ */
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdint.h>
+
+#include "state.h"
+
+#define CHECKPOINT_MAGIC 0x54504b434f44554cULL // "LUDOCKPT"
+#define CHECKPOINT_VERSION 1
+
+// everything needed to carry on from the end of a turn; the rings are
+// left out, every record in them has already been drawn and logged
+struct checkpoint {
+  uint64_t magic;
+  uint32_t version;
+  uint32_t size; // sizeof(struct checkpoint) of the writer
+  uint64_t seed;
+  int num_players;
+  int board[BOARD_SIZE];
+  int players[MAX_PLAYERS + 1];
+  uint32_t turn;
+  int current;
+  uint64_t dice[MAX_PLAYERS];
+  struct ludo_stats stats;
+};
+
+int checkpoint_start(const char *path, const int *board, int num_players,
+                     uint64_t seed);
+void checkpoint_save(const struct ludo_state *state);
+void checkpoint_stop();
+
+int checkpoint_load(const char *path, struct checkpoint *ck);
+void checkpoint_restore(const struct checkpoint *ck, struct ludo_state *state);
+
+#endif
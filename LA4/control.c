@@ -0,0 +1,275 @@
+/*
+ * control.c - Binary control protocol for the coordinator
+ * CS39002 Operating Systems Laboratory
+ *
+ * Served from the CP's own loop rather than a thread, so a request runs
+ * exactly like the same command typed at the prompt: the CP polls the
+ * listening socket and its clients along with stdin (control_fds(),
+ * control_serve()). Each read takes every complete request it finds and
+ * answers them with one write, which is what makes pipelining pay off.
+ * Subscribers get a CTL_STATS reply pushed after every so many turns.
+ * A push is written as soon as the turns are played, except to the client
+ * whose request played them: its earlier replies are still unwritten, so
+ * the push waits in the same buffer behind that request's reply.
+ *
+ * Author: Ashutosh Sharma
+ * Roll: 23CS10005
+ */
+
+#include "control.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define CTL_READ_BYTES 4096  // requests taken per read, 512 of them
+#define CTL_WRITE_BYTES 8192 // replies gathered before a write
+#define CTL_SEND_TIMEOUT_S 1 // a client that stops reading is dropped
+
+struct ctl_client {
+  int fd; // -1 if the slot is free
+  size_t have;
+  char buf[CTL_READ_BYTES]; // requests read, the last maybe partial
+  uint32_t sub_every;       // turns between pushes, 0 = not subscribed
+  uint32_t sub_next;        // turn at which the next push is due
+  uint16_t sub_tag;
+  int sub_due; // a push waits for the reply to the request that played
+};
+
+static struct ludo_state *c_state = NULL;
+static ctl_handler c_handler = NULL;
+static int c_listen_fd = -1;
+static char c_socket_path[108] = "";
+static struct ctl_client c_clients[CTL_MAX_CLIENTS];
+static struct ctl_client *c_serving = NULL; // whose request is running
+
+static int write_all(int fd, const char *buffer, size_t len) {
+  while (len > 0) {
+    ssize_t n = write(fd, buffer, len);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return -1;
+    buffer += n;
+    len -= n;
+  }
+  return 0;
+}
+
+static void drop_client(struct ctl_client *c) {
+  close(c->fd);
+  c->fd = -1;
+}
+
+static uint64_t stat_load(_Atomic uint64_t *counter) {
+  return atomic_load_explicit(counter, memory_order_relaxed);
+}
+
+void control_stats(struct ctl_stats *out) {
+  struct ludo_stats *st = &c_state->stats;
+  struct stage_stat *turn = &st->stages[STAGE_TURN];
+
+  out->turns = stat_load(&st->turns);
+  out->cancelled = stat_load(&st->cancelled);
+  out->overshoot = stat_load(&st->overshoot);
+  out->blocked = stat_load(&st->blocked);
+  out->ladders = stat_load(&st->ladders);
+  out->snakes = stat_load(&st->snakes);
+  out->finished = stat_load(&st->finished);
+  out->redraws = stat_load(&st->redraws);
+  out->turn_count = stat_load(&turn->count);
+  out->turn_total_ns = stat_load(&turn->total_ns);
+  out->turn_max_ns = stat_load(&turn->max_ns);
+}
+
+// a CTL_STATS push for c's subscription, appended at out
+static size_t push_stats(struct ctl_client *c, char *out) {
+  struct ctl_stats stats;
+  struct ctl_reply rep = {CTL_STATS, CTL_OK, c->sub_tag, sizeof(stats)};
+  control_stats(&stats);
+  memcpy(out, &rep, sizeof(rep));
+  memcpy(out + sizeof(rep), &stats, sizeof(stats));
+  return sizeof(rep) + sizeof(stats);
+}
+
+// run one request, reply appended at out
+static size_t run_request(struct ctl_client *c, const struct ctl_request *req,
+                          char *out) {
+  struct ctl_reply rep = {req->op, CTL_OK, req->tag, 0};
+  union {
+    struct ctl_state state;
+    struct ctl_stats stats;
+  } payload;
+
+  if (req->op == CTL_STATS) {
+    control_stats(&payload.stats);
+    rep.len = sizeof(payload.stats);
+  } else if (req->op == CTL_SUBSCRIBE) {
+    c->sub_every = req->arg;
+    c->sub_next = atomic_load(&c_state->turn) + req->arg;
+    c->sub_tag = req->tag;
+  } else {
+    rep.status = c_handler(req, &payload, &rep.len);
+  }
+  memcpy(out, &rep, sizeof(rep));
+  memcpy(out + sizeof(rep), &payload, rep.len);
+  return sizeof(rep) + rep.len;
+}
+
+static void serve_client(struct ctl_client *c) {
+  char out[CTL_WRITE_BYTES];
+  size_t out_len = 0, done = 0;
+
+  ssize_t n = read(c->fd, c->buf + c->have, sizeof(c->buf) - c->have);
+  if (n < 0 && errno == EINTR)
+    return;
+  if (n <= 0) {
+    drop_client(c);
+    return;
+  }
+  c->have += n;
+
+  while (c->have - done >= sizeof(struct ctl_request)) {
+    struct ctl_request req;
+    memcpy(&req, c->buf + done, sizeof(req));
+    done += sizeof(req);
+
+    // room for the reply and a push it may make due
+    if (out_len + 2 * (sizeof(struct ctl_reply) + sizeof(struct ctl_stats)) >
+        sizeof(out)) {
+      if (write_all(c->fd, out, out_len) < 0) {
+        drop_client(c);
+        return;
+      }
+      out_len = 0;
+    }
+    c_serving = c;
+    out_len += run_request(c, &req, out + out_len);
+    c_serving = NULL;
+    if (c->sub_due) {
+      out_len += push_stats(c, out + out_len);
+      c->sub_due = 0;
+    }
+  }
+  memmove(c->buf, c->buf + done, c->have - done);
+  c->have -= done;
+
+  if (write_all(c->fd, out, out_len) < 0)
+    drop_client(c);
+}
+
+static void accept_client() {
+  int fd = accept(c_listen_fd, NULL, NULL);
+  if (fd < 0)
+    return;
+
+  for (int i = 0; i < CTL_MAX_CLIENTS; i++) {
+    struct ctl_client *c = &c_clients[i];
+    if (c->fd >= 0)
+      continue;
+    struct timeval tv = {CTL_SEND_TIMEOUT_S, 0};
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    memset(c, 0, sizeof(*c));
+    c->fd = fd;
+    return;
+  }
+  close(fd); // full
+}
+
+int control_fds(struct pollfd *fds) {
+  int n = 0;
+  if (c_listen_fd < 0)
+    return 0;
+
+  fds[n++] = (struct pollfd){c_listen_fd, POLLIN, 0};
+  for (int i = 0; i < CTL_MAX_CLIENTS; i++)
+    if (c_clients[i].fd >= 0)
+      fds[n++] = (struct pollfd){c_clients[i].fd, POLLIN, 0};
+  return n;
+}
+
+void control_serve(struct pollfd *fds, int n) {
+  for (int i = 0; i < n; i++) {
+    if (fds[i].revents == 0)
+      continue;
+    if (fds[i].fd == c_listen_fd) {
+      accept_client();
+      continue;
+    }
+    for (int j = 0; j < CTL_MAX_CLIENTS; j++)
+      if (c_clients[j].fd == fds[i].fd)
+        serve_client(&c_clients[j]);
+  }
+}
+
+void control_notify() {
+  if (c_listen_fd < 0)
+    return;
+  uint32_t turn = atomic_load(&c_state->turn);
+
+  for (int i = 0; i < CTL_MAX_CLIENTS; i++) {
+    struct ctl_client *c = &c_clients[i];
+    if (c->fd < 0 || c->sub_every == 0 || turn < c->sub_next)
+      continue;
+    c->sub_next = turn + c->sub_every;
+
+    // the client being served still has replies gathered in its buffer;
+    // its push goes after the reply to the request that played the turns
+    if (c == c_serving) {
+      c->sub_due = 1;
+      continue;
+    }
+    char out[sizeof(struct ctl_reply) + sizeof(struct ctl_stats)];
+    if (write_all(c->fd, out, push_stats(c, out)) < 0)
+      drop_client(c);
+  }
+}
+
+int control_start(const char *path, struct ludo_state *state,
+                  ctl_handler handler) {
+  c_state = state;
+  c_handler = handler;
+  for (int i = 0; i < CTL_MAX_CLIENTS; i++)
+    c_clients[i].fd = -1;
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    perror("socket (control)");
+    return -1;
+  }
+
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+  unlink(path);
+  if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    perror("bind (control)");
+    close(fd);
+    return -1;
+  }
+  strncpy(c_socket_path, path, sizeof(c_socket_path) - 1);
+
+  if (listen(fd, CTL_MAX_CLIENTS) < 0) {
+    perror("listen (control)");
+    close(fd);
+    return -1;
+  }
+  c_listen_fd = fd;
+  return 0;
+}
+
+void control_stop() {
+  if (c_listen_fd < 0)
+    return;
+  for (int i = 0; i < CTL_MAX_CLIENTS; i++)
+    if (c_clients[i].fd >= 0)
+      drop_client(&c_clients[i]);
+  close(c_listen_fd);
+  c_listen_fd = -1;
+  unlink(c_socket_path);
+}
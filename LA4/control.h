@@ -0,0 +1,99 @@
+/*
+ * control.h - Binary control protocol for the coordinator
+ * CS39002 Operating Systems Laboratory
+ *
+ * ludo --control <path> listens on a Unix socket for the same commands
+ * as the prompt. A request is 8 bytes and every request gets one reply:
+ * an 8-byte header with the request's tag, then len bytes of payload.
+ * Requests may be pipelined; they run and are answered in order. A
+ * subscriber's CTL_STATS pushes come between whole replies: one made due
+ * by the subscriber's own CTL_NEXT right after that request's reply,
+ * others as the turns are played. Both ends are on one machine, so fields
+ * are in host byte order.
+ *
+ * Author: Ashutosh Sharma
+ * Roll: 23CS10005
+ */
+
+#ifndef CONTROL_H
+#define CONTROL_H
+
+#include <poll.h>
+#include <stdint.h>
+
+#include "state.h"
+
+// request ops
+#define CTL_NEXT 1      // play arg turns (0 or 1: one turn, as "next")
+#define CTL_DELAY 2     // autoplay delay of arg ms
+#define CTL_AUTOPLAY 3  // autoplay on (arg 1) or off (arg 0)
+#define CTL_QUIT 4      // end the game
+#define CTL_STATE 5     // reply with a struct ctl_state
+#define CTL_STATS 6     // reply with a struct ctl_stats
+#define CTL_SUBSCRIBE 7 // push a CTL_STATS reply every arg turns, 0 = stop
+
+// reply status
+#define CTL_OK 0
+#define CTL_EBADOP 1 // unknown op
+#define CTL_EOVER 2  // the game is over
+
+#define CTL_MAX_CLIENTS 16
+
+struct ctl_request {
+  uint8_t op;
+  uint8_t pad;
+  uint16_t tag; // echoed in the reply
+  uint32_t arg;
+};
+
+struct ctl_reply {
+  uint8_t op; // op of the request, or CTL_STATS for a pushed update
+  uint8_t status;
+  uint16_t tag; // a push carries the tag of its CTL_SUBSCRIBE
+  uint32_t len; // payload bytes that follow
+};
+
+struct ctl_state {
+  uint32_t turn;
+  uint32_t delay_ms;
+  uint8_t num_players;
+  uint8_t active;
+  int8_t current; // player who moved last, -1 at the start
+  uint8_t autoplay;
+  uint8_t pos[MAX_PLAYERS];
+  uint8_t pad[2];
+};
+
+struct ctl_stats {
+  uint64_t turns;
+  uint64_t cancelled;
+  uint64_t overshoot;
+  uint64_t blocked;
+  uint64_t ladders;
+  uint64_t snakes;
+  uint64_t finished;
+  uint64_t redraws;
+  uint64_t turn_count; // STAGE_TURN latency, as seen by the CP
+  uint64_t turn_total_ns;
+  uint64_t turn_max_ns;
+};
+
+// runs one request for the CP: fills payload (room for a struct
+// ctl_state) and *len, returns a CTL_* status
+typedef int (*ctl_handler)(const struct ctl_request *req, void *payload,
+                           uint32_t *len);
+
+int control_start(const char *path, struct ludo_state *state,
+                  ctl_handler handler);
+// pollfds for the listening socket and every client, at most
+// CTL_MAX_CLIENTS + 1
+int control_fds(struct pollfd *fds);
+// accept and serve whatever poll() found ready in fds
+void control_serve(struct pollfd *fds, int n);
+// push stats to the subscribers that are due, after turns were played;
+// the one whose request is running gets it after that request's reply
+void control_notify();
+void control_stats(struct ctl_stats *out);
+void control_stop();
+
+#endif
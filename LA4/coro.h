@@ -0,0 +1,43 @@
+/*
+ * coro.h - Stackless coroutines for Snake Ludo player tasks
+ * CS39002 Operating Systems Laboratory
+ *
+ * A coroutine is a function that keeps its resume point in a struct coro
+ * and switches on it when called again, so it needs no stack of its own:
+ * a suspended task is only the struct it lives in. Locals do not survive
+ * a CORO_YIELD; anything needed after one belongs in the task struct.
+ *
+ * Author: Ashutosh Sharma
+ * Roll: 23CS10005
+ */
+
+#ifndef CORO_H
+#define CORO_H
+
+#define CORO_SUSPENDED 0
+#define CORO_DONE 1
+
+struct coro {
+  int line; // where to resume, 0 before the first call
+};
+
+#define CORO_BEGIN(c)                                                          \
+  switch ((c)->line) {                                                         \
+  case 0:
+
+// give control back to the scheduler; the next call carries on here
+#define CORO_YIELD(c)                                                          \
+  do {                                                                         \
+    (c)->line = __LINE__;                                                      \
+    return CORO_SUSPENDED;                                                     \
+  case __LINE__:;                                                              \
+  } while (0)
+
+#define CORO_END(c)                                                            \
+  }                                                                            \
+  (c)->line = -1;                                                              \
+  return CORO_DONE
+
+#define CORO_FINISHED(c) ((c)->line == -1)
+
+#endif
@@ -0,0 +1,261 @@
+/*
+ * ctl.c - ludo-ctl: client for the coordinator's control socket
+ * CS39002 Operating Systems Laboratory
+ *
+ * Usage: ludo-ctl [-s socket] <command>
+ *   next [n] | delay <ms> | autoplay [on|off] | quit | state | stats
+ *   watch <turns>        - print the stats pushed every <turns> turns
+ *   bench [count] [depth] - pipelined state requests, depth in flight
+ *   drive [count] [depth] - the same with one-turn next requests, which
+ *                           plays the game out as fast as it answers
+ *
+ * The bench and drive modes check that every reply comes back in order
+ * with its tag, so they double as a test of the protocol.
+ *
+ * Author: Ashutosh Sharma
+ * Roll: 23CS10005
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "control.h"
+
+#define DEFAULT_SOCKET "/tmp/ludo.control"
+#define DEFAULT_DEPTH 64
+#define MAX_DEPTH 512 // what the CP takes in one read
+
+const char player_symbols[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+
+int ctl_fd = -1;
+FILE *ctl_in = NULL; // buffered reads of the replies
+uint16_t next_tag = 0;
+
+int ctl_connect(const char *path) {
+  ctl_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (ctl_fd < 0) {
+    perror("socket");
+    return -1;
+  }
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+  if (connect(ctl_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    perror("connect");
+    return -1;
+  }
+  ctl_in = fdopen(ctl_fd, "r");
+  return ctl_in != NULL ? 0 : -1;
+}
+
+int send_requests(const struct ctl_request *reqs, int n) {
+  const char *buffer = (const char *)reqs;
+  size_t len = n * sizeof(*reqs);
+  while (len > 0) {
+    ssize_t w = write(ctl_fd, buffer, len);
+    if (w < 0 && errno == EINTR)
+      continue;
+    if (w <= 0) {
+      perror("write");
+      return -1;
+    }
+    buffer += w;
+    len -= w;
+  }
+  return 0;
+}
+
+// next reply, payload into a buffer of max bytes; -1 once the CP is gone
+int read_reply(struct ctl_reply *rep, void *payload, size_t max) {
+  if (fread(rep, sizeof(*rep), 1, ctl_in) != 1)
+    return -1;
+  if (rep->len > max) {
+    fprintf(stderr, "Reply of %u bytes, expected at most %zu\n", rep->len,
+            max);
+    return -1;
+  }
+  if (rep->len > 0 && fread(payload, rep->len, 1, ctl_in) != 1)
+    return -1;
+  return 0;
+}
+
+// one request and its reply
+int call(uint8_t op, uint32_t arg, void *payload, size_t max) {
+  struct ctl_request req = {op, 0, next_tag++, arg};
+  struct ctl_reply rep;
+  if (send_requests(&req, 1) < 0 || read_reply(&rep, payload, max) < 0)
+    return -1;
+  if (rep.tag != req.tag || rep.op != op) {
+    fprintf(stderr, "Reply for op %u tag %u, expected op %u tag %u\n",
+            rep.op, rep.tag, op, req.tag);
+    return -1;
+  }
+  if (rep.status == CTL_EOVER)
+    printf("The game is over\n");
+  else if (rep.status != CTL_OK)
+    printf("Request failed (status %u)\n", rep.status);
+  return rep.status;
+}
+
+void print_state(const struct ctl_state *st) {
+  printf("turn %u, %u/%u active, autoplay %s, delay %u ms\n", st->turn,
+         st->active, st->num_players, st->autoplay ? "on" : "off",
+         st->delay_ms);
+  for (int i = 0; i < st->num_players; i++)
+    printf("%c %3u%s", player_symbols[i], st->pos[i],
+           (i + 1) % 8 == 0 || i + 1 == st->num_players ? "\n" : "   ");
+}
+
+void print_stats(const struct ctl_stats *s) {
+  printf("turns %lu: %lu cancelled, %lu overshoot, %lu blocked, "
+         "%lu ladders, %lu snakes, %lu finished, %lu redraws",
+         s->turns, s->cancelled, s->overshoot, s->blocked, s->ladders,
+         s->snakes, s->finished, s->redraws);
+  if (s->turn_count)
+    printf(", turn mean %.1f us max %.1f us",
+           s->turn_total_ns / 1e3 / s->turn_count, s->turn_max_ns / 1e3);
+  printf("\n");
+}
+
+// count requests of op with depth of them in flight, refilled half a
+// window at a time; checks every reply's tag and order
+int pipeline(uint8_t op, long count, int depth) {
+  struct ctl_request reqs[MAX_DEPTH];
+  union {
+    struct ctl_state state;
+    struct ctl_stats stats;
+  } payload;
+  long sent = 0, done = 0, over = 0;
+  uint16_t expect = next_tag;
+
+  uint64_t start = stat_now_ns();
+  while (done < count) {
+    int room = depth - (int)(sent - done);
+    if (sent < count && room >= depth / 2) {
+      int n = room < count - sent ? room : (int)(count - sent);
+      for (int i = 0; i < n; i++)
+        reqs[i] = (struct ctl_request){op, 0, next_tag++, 1};
+      if (send_requests(reqs, n) < 0)
+        return -1;
+      sent += n;
+    }
+
+    struct ctl_reply rep;
+    if (read_reply(&rep, &payload, sizeof(payload)) < 0) {
+      fprintf(stderr, "Connection closed after %ld replies\n", done);
+      return -1;
+    }
+    if (rep.op != op || rep.tag != expect) {
+      fprintf(stderr, "Reply %ld: op %u tag %u, expected op %u tag %u\n",
+              done, rep.op, rep.tag, op, expect);
+      return -1;
+    }
+    expect++;
+    done++;
+    over += rep.status == CTL_EOVER;
+  }
+  double secs = (stat_now_ns() - start) / 1e9;
+
+  printf("%ld requests in order, %d in flight: %.3f s, %.0f requests/s, "
+         "%.1f us each\n",
+         count, depth, secs, count / secs, secs * 1e6 / count);
+  if (over)
+    printf("%ld of them found the game over\n", over);
+  return 0;
+}
+
+// print pushed stats until the CP goes away
+int watch(uint32_t every) {
+  struct ctl_request req = {CTL_SUBSCRIBE, 0, next_tag++, every};
+  struct ctl_reply rep;
+  struct ctl_stats stats;
+
+  if (send_requests(&req, 1) < 0)
+    return -1;
+  while (read_reply(&rep, &stats, sizeof(stats)) == 0) {
+    if (rep.op == CTL_STATS)
+      print_stats(&stats);
+  }
+  return 0;
+}
+
+void usage(const char *prog) {
+  printf("Usage: %s [-s socket] <command>\n"
+         "  next [n] | delay <ms> | autoplay [on|off] | quit | state | stats\n"
+         "  watch <turns>          - print stats pushed every <turns> turns\n"
+         "  bench [count] [depth]  - pipelined state requests (default: "
+         "100000, %d)\n"
+         "  drive [count] [depth]  - pipelined one-turn next requests\n",
+         prog, DEFAULT_DEPTH);
+}
+
+int main(int argc, char *argv[]) {
+  const char *path = DEFAULT_SOCKET;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "s:h")) != -1) {
+    if (opt == 's') {
+      path = optarg;
+    } else {
+      usage(argv[0]);
+      return opt == 'h' ? 0 : 1;
+    }
+  }
+  if (optind >= argc) {
+    usage(argv[0]);
+    return 1;
+  }
+  const char *cmd = argv[optind];
+  const char *arg1 = optind + 1 < argc ? argv[optind + 1] : NULL;
+  const char *arg2 = optind + 2 < argc ? argv[optind + 2] : NULL;
+
+  if (ctl_connect(path) < 0)
+    return 1;
+
+  union {
+    struct ctl_state state;
+    struct ctl_stats stats;
+  } payload;
+  int status = 0;
+
+  if (strcmp(cmd, "next") == 0) {
+    status = call(CTL_NEXT, arg1 ? atol(arg1) : 1, NULL, 0);
+  } else if (strcmp(cmd, "delay") == 0 && arg1 != NULL) {
+    status = call(CTL_DELAY, atol(arg1), NULL, 0);
+  } else if (strcmp(cmd, "autoplay") == 0) {
+    status = call(CTL_AUTOPLAY, arg1 == NULL || strcmp(arg1, "off") != 0,
+                  NULL, 0);
+  } else if (strcmp(cmd, "quit") == 0) {
+    status = call(CTL_QUIT, 0, NULL, 0);
+  } else if (strcmp(cmd, "state") == 0) {
+    status = call(CTL_STATE, 0, &payload, sizeof(payload));
+    if (status == CTL_OK)
+      print_state(&payload.state);
+  } else if (strcmp(cmd, "stats") == 0) {
+    status = call(CTL_STATS, 0, &payload, sizeof(payload));
+    if (status == CTL_OK)
+      print_stats(&payload.stats);
+  } else if (strcmp(cmd, "watch") == 0) {
+    status = watch(arg1 ? atol(arg1) : 1);
+  } else if (strcmp(cmd, "bench") == 0 || strcmp(cmd, "drive") == 0) {
+    long count = arg1 ? atol(arg1) : 100000;
+    int depth = arg2 ? atoi(arg2) : DEFAULT_DEPTH;
+    if (count < 1 || depth < 2 || depth > MAX_DEPTH) {
+      fprintf(stderr, "count must be positive and depth 2-%d\n", MAX_DEPTH);
+      return 1;
+    }
+    status = pipeline(cmd[0] == 'b' ? CTL_STATE : CTL_NEXT, count, depth);
+  } else {
+    usage(argv[0]);
+    return 1;
+  }
+
+  fclose(ctl_in);
+  return status == 0 ? 0 : 1;
+}
@@ -0,0 +1,313 @@
+/*
+ * engine.c - Headless game engine for Snake Ludo
+ * CS39002 Operating Systems Laboratory
+ *
+ * Same rules as the player processes in players.c, applied to a
+ * struct game in plain memory.
+ *
+ * A turn's dice have only DICE_OUTCOMES results, so games that do not
+ * have to match the game processes die for die sample the whole roll with
+ * one draw from a Walker alias table instead of rolling in a loop.
+ *
+ * Author: Ashutosh Sharma
+ * Roll: 23CS10005
+ */
+
+#include "engine.h"
+#include "simd.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// the dice of each outcome, and the alias table over them
+struct dice_outcome {
+  int ndice;
+  int dice[3];
+  int total; // 0 if cancelled
+};
+
+static struct dice_outcome outcomes[DICE_OUTCOMES];
+static uint32_t alias_prob[DICE_OUTCOMES]; // keep the column below this
+static uint8_t alias_pick[DICE_OUTCOMES][2]; // {column, its alias}
+
+// Vose's construction, in units of 1/216 (three dice) per column
+__attribute__((constructor)) static void dice_alias_init() {
+  uint32_t weight[DICE_OUTCOMES];
+  int small[DICE_OUTCOMES], large[DICE_OUTCOMES];
+  int ns = 0, nl = 0;
+
+  for (int o = 0; o < DICE_OUTCOMES; o++) {
+    struct dice_outcome *out = &outcomes[o];
+    int sixes = o < 15 ? o / 5 : 3;
+    for (int d = 0; d < sixes; d++)
+      out->dice[out->ndice++] = 6;
+    if (sixes < 3)
+      out->dice[out->ndice++] = o % 5 + 1;
+    for (int d = 0; d < out->ndice; d++)
+      out->total += out->dice[d];
+    if (sixes == 3)
+      out->total = 0;
+
+    // 216 / 6^ndice, times the column count
+    weight[o] = (sixes == 0 ? 36 : sixes == 1 ? 6 : 1) * DICE_OUTCOMES;
+    if (weight[o] < 216)
+      small[ns++] = o;
+    else
+      large[nl++] = o;
+  }
+
+  while (ns > 0 && nl > 0) {
+    int s = small[--ns], l = large[--nl];
+    alias_prob[s] = (uint32_t)(((uint64_t)weight[s] << 32) / 216);
+    alias_pick[s][1] = l;
+    weight[l] -= 216 - weight[s];
+    if (weight[l] < 216)
+      small[ns++] = l;
+    else
+      large[nl++] = l;
+  }
+  while (nl > 0) {
+    alias_prob[large[--nl]] = UINT32_MAX;
+    alias_pick[large[nl]][1] = large[nl];
+  }
+  while (ns > 0) { // only reached through rounding
+    alias_prob[small[--ns]] = UINT32_MAX;
+    alias_pick[small[ns]][1] = small[ns];
+  }
+  for (int o = 0; o < DICE_OUTCOMES; o++)
+    alias_pick[o][0] = o;
+}
+
+// read board configuration from ludo.txt (quiet version of ludo.c's)
+int board_load(int *board, const char *filename) {
+  FILE *fp = fopen(filename, "r");
+  if (fp == NULL) {
+    perror("fopen (board)");
+    return -1;
+  }
+
+  memset(board, 0, BOARD_SIZE * sizeof(int));
+
+  char type;
+  int from, to;
+
+  while (fscanf(fp, " %c", &type) == 1) {
+    if (type == 'E')
+      break;
+
+    if (fscanf(fp, "%d %d", &from, &to) != 2 || from <= 0 ||
+        from >= FINISH_CELL || to <= 0 || to > FINISH_CELL) {
+      fprintf(stderr, "Error reading board file %s\n", filename);
+      fclose(fp);
+      return -1;
+    }
+
+    if (type == 'L' || type == 'S')
+      board[from] = to - from;
+  }
+
+  fclose(fp);
+  return 0;
+}
+
+void game_init(struct game *g, int num_players, uint64_t seed) {
+  memset(g, 0, sizeof(*g));
+  g->num_players = num_players;
+  g->active = num_players;
+  g->current = -1;
+  g->rng = seed;
+}
+
+// dice the way ludo deals them: player i rolls from stream i of the seed
+void game_init_streams(struct game *g, int num_players, uint64_t seed) {
+  game_init(g, num_players, seed);
+  g->streams = 1;
+  for (int i = 0; i < num_players; i++)
+    g->dice[i] = rng_stream(seed, i);
+}
+
+// next active player in round-robin, -1 if everyone finished
+int game_next_player(struct game *g) {
+  int next = occ_next_active(g->pos, g->num_players, g->current, FINISH_CELL);
+  if (next >= 0)
+    g->current = next;
+  return next;
+}
+
+int game_is_occupied(const struct game *g, int cell, int player) {
+  if (cell <= 0 || cell >= FINISH_CELL)
+    return 0;
+  return occ_any(g->pos, g->num_players, cell, player);
+}
+
+// roll up to three dice, returns the total or 0 if three 6s
+int game_roll(uint64_t *rng, struct turn *t) {
+  t->total = 0;
+  t->ndice = 0;
+
+  while (t->ndice < 3) {
+    int die = rng_die(rng);
+    t->dice[t->ndice++] = die;
+    t->total += die;
+    if (die != 6)
+      return t->total;
+  }
+
+  t->total = 0; // three 6s cancel the move
+  return 0;
+}
+
+// the whole roll from one draw: low bits pick a column, high bits
+// choose between it and its alias (by index, not a branch); the dice are
+// filled in for logging
+int game_roll_alias(uint64_t *rng, struct turn *t) {
+  uint64_t r = rng_next(rng);
+  int col = r & (DICE_OUTCOMES - 1);
+  int o = alias_pick[col][(uint32_t)(r >> 32) >= alias_prob[col]];
+  const struct dice_outcome *out = &outcomes[o];
+
+  t->ndice = out->ndice;
+  memcpy(t->dice, out->dice, sizeof(t->dice));
+  t->total = out->total;
+  return t->total;
+}
+
+// two plain dice, no rerolls
+static inline int roll_two(uint64_t *rng, struct turn *t) {
+  t->dice[0] = rng_die(rng);
+  t->dice[1] = rng_die(rng);
+  t->ndice = 2;
+  t->total = t->dice[0] + t->dice[1];
+  return t->total;
+}
+
+// player other than player on cell (0 < cell < 100), -1 if none
+static int game_occupant(const struct game *g, int cell, int player) {
+  for (int i = 0; i < g->num_players; i++)
+    if (i != player && g->pos[i] == cell)
+      return i;
+  return -1;
+}
+
+// whether player may enter cell; under LAND_CAPTURE whoever is on it
+// goes home first
+static inline __attribute__((always_inline)) int
+enter_cell(struct game *g, struct turn *t, int cell, int player, int land) {
+  if (land == LAND_BLOCK)
+    return !game_is_occupied(g, cell, player);
+  if (cell <= 0 || cell >= FINISH_CELL)
+    return 1;
+  int other = game_occupant(g, cell, player);
+  if (other >= 0) {
+    g->pos[other] = 0;
+    t->captured = other;
+  }
+  return 1;
+}
+
+// one turn under the given rules. Every turn function is this body with
+// constant rules, so each variant compiles without the checks it does
+// not need; game_turn_rules() passes them at run time instead.
+static inline __attribute__((always_inline)) int
+turn_with(const int *board, struct game *g, struct turn *t, int finish,
+          int dice, int land) {
+  int p = game_next_player(g);
+  if (p < 0)
+    return -1;
+
+  int pos = g->pos[p];
+  t->player = p;
+  t->from = pos;
+  t->to = pos;
+  t->hops = 0;
+  t->rank = 0;
+  t->captured = -1;
+  g->turns++;
+
+  int total;
+  if (dice == DICE_TWO)
+    total = roll_two(g->streams ? &g->dice[p] : &g->rng, t);
+  else
+    total = g->streams ? game_roll(&g->dice[p], t)
+                       : game_roll_alias(&g->rng, t);
+  if (total == 0) {
+    t->result = TURN_CANCELLED;
+    return 0;
+  }
+
+  int new_pos = pos + t->total;
+  if (new_pos > FINISH_CELL) {
+    if (finish == FINISH_EXACT) {
+      t->result = TURN_OVERSHOOT;
+      return 0;
+    }
+    new_pos = 2 * FINISH_CELL - new_pos;
+  }
+  if (!enter_cell(g, t, new_pos, p, land)) {
+    t->result = TURN_BLOCKED;
+    return 0;
+  }
+
+  // follow chains; a cell is never visited twice so loops terminate
+  unsigned char visited[BOARD_SIZE] = {0};
+  while (new_pos > 0 && new_pos < FINISH_CELL && board[new_pos] != 0 &&
+         !visited[new_pos]) {
+    visited[new_pos] = 1;
+    int next = new_pos + board[new_pos];
+    if (!enter_cell(g, t, next, p, land))
+      break;
+    new_pos = next;
+    t->hops++;
+  }
+
+  g->pos[p] = new_pos;
+  t->to = new_pos;
+  t->result = TURN_MOVED;
+
+  if (new_pos == FINISH_CELL) {
+    t->rank = g->num_players - g->active + 1;
+    g->rank[p] = t->rank;
+    g->active--;
+  }
+  return 0;
+}
+
+// play one turn for the next active player, returns -1 if game is over
+int game_turn(const int *board, struct game *g, struct turn *t) {
+  return turn_with(board, g, t, FINISH_EXACT, DICE_SIXES, LAND_BLOCK);
+}
+
+int game_turn_rules(const int *board, struct game *g, struct turn *t,
+                    const struct rules *r) {
+  return turn_with(board, g, t, r->finish, r->dice, r->land);
+}
+
+// name, finish, dice, land; two dice never make 1, so they bounce or a
+// token on 99 could never finish
+#define RULES_VARIANTS(X)                                                      \
+  X(bounce, FINISH_BOUNCE, DICE_SIXES, LAND_BLOCK)                             \
+  X(two_dice, FINISH_BOUNCE, DICE_TWO, LAND_BLOCK)                             \
+  X(capture, FINISH_EXACT, DICE_SIXES, LAND_CAPTURE)                           \
+  X(house, FINISH_BOUNCE, DICE_TWO, LAND_CAPTURE)
+
+#define RULES_TURN(name, finish, dice, land)                                   \
+  static int game_turn_##name(const int *board, struct game *g,                \
+                              struct turn *t) {                                \
+    return turn_with(board, g, t, finish, dice, land);                         \
+  }
+RULES_VARIANTS(RULES_TURN)
+
+#define RULES_ENTRY(name, finish, dice, land)                                  \
+  {#name, {finish, dice, land}, game_turn_##name},
+const struct rules_variant rules_variants[] = {
+    {"classic", {FINISH_EXACT, DICE_SIXES, LAND_BLOCK}, game_turn},
+    RULES_VARIANTS(RULES_ENTRY)};
+const int num_rules_variants =
+    sizeof(rules_variants) / sizeof(rules_variants[0]);
+
+const struct rules_variant *rules_find(const char *name) {
+  for (int i = 0; i < num_rules_variants; i++)
+    if (strcmp(rules_variants[i].name, name) == 0)
+      return &rules_variants[i];
+  return NULL;
+}
@@ -0,0 +1,107 @@
+/*
+ * engine.h - Headless game engine for Snake Ludo
+ * CS39002 Operating Systems Laboratory
+ *
+ * The rules from players.c (dice with 6s, overshoot, occupancy, chained
+ * snakes and ladders) without any printing or signalling, so that many
+ * games can be advanced from one process.
+ *
+ * Author: Ashutosh Sharma
+ * Roll: 23CS10005
+ */
+
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include <stdint.h>
+
+#include "rng.h"
+
+#define BOARD_SIZE 101 // 0-100, index 0 unused
+#define MAX_PLAYERS 26
+#define FINISH_CELL 100
+
+// result of a single turn
+#define TURN_MOVED 0
+#define TURN_CANCELLED 1 // three 6s
+#define TURN_OVERSHOOT 2 // would pass 100
+#define TURN_BLOCKED 3   // target cell occupied
+
+// house rules, one choice of each; see RULES_VARIANTS in engine.c
+#define FINISH_EXACT 0  // a roll past 100 forfeits the move
+#define FINISH_BOUNCE 1 // the steps past 100 are walked back from it
+#define DICE_SIXES 0    // one die, a 6 rolls again, three 6s cancel
+#define DICE_TWO 1      // the sum of two dice
+#define LAND_BLOCK 0    // an occupied cell cannot be entered
+#define LAND_CAPTURE 1  // the token on it is sent back home
+
+// every way a turn's dice can fall: 1-5, 6+1..6+5, 6+6+1..6+6+5, 6+6+6
+#define DICE_OUTCOMES 16
+
+// state of one game
+struct game {
+  uint16_t pos[MAX_PLAYERS]; // compact so the SIMD scans in simd.c apply
+  int rank[MAX_PLAYERS]; // 0 while playing, 1.. once finished
+  int num_players;
+  int active;  // players not yet at 100
+  int current; // player who moved last (-1 before the first turn)
+  uint64_t rng;               // one draw per turn from the alias table
+  uint64_t turns;
+  int streams;                // roll die by die from dice[player] instead
+  uint64_t dice[MAX_PLAYERS]; // per-player streams, as the game processes
+};
+
+// what happened in one turn
+struct turn {
+  int player;
+  int from;
+  int to;
+  int total; // dice total, 0 if cancelled
+  int ndice;
+  int dice[3];
+  int result;   // TURN_*
+  int hops;     // snakes/ladders taken
+  int rank;     // rank reached, 0 if not finished this turn
+  int captured; // last player sent home (LAND_CAPTURE), -1 if none
+};
+
+struct rules {
+  int finish; // FINISH_*
+  int dice;   // DICE_*
+  int land;   // LAND_*
+};
+
+typedef int (*turn_fn)(const int *board, struct game *g, struct turn *t);
+
+// a set of rules with its own compiled turn function
+struct rules_variant {
+  const char *name;
+  struct rules rules;
+  turn_fn turn;
+};
+
+extern const struct rules_variant rules_variants[];
+extern const int num_rules_variants;
+
+// read ludo.txt into board (modifier per cell), returns -1 on error
+int board_load(int *board, const char *filename);
+
+void game_init(struct game *g, int num_players, uint64_t seed);
+void game_init_streams(struct game *g, int num_players, uint64_t seed);
+int game_next_player(struct game *g);
+int game_is_occupied(const struct game *g, int cell, int player);
+int game_roll(uint64_t *rng, struct turn *t);
+int game_roll_alias(uint64_t *rng, struct turn *t);
+int game_turn(const int *board, struct game *g, struct turn *t);
+
+// game_turn() on the board compiled into board_gen.h by ludo-gen
+// (engine_gen.c); board is not read
+int game_turn_gen(const int *board, struct game *g, struct turn *t);
+
+// variant by name (classic is game_turn()), NULL if unknown
+const struct rules_variant *rules_find(const char *name);
+// the same turn with the rules checked at run time, for comparison
+int game_turn_rules(const int *board, struct game *g, struct turn *t,
+                    const struct rules *r);
+
+#endif
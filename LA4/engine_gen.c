@@ -0,0 +1,74 @@
+/*
+ * engine_gen.c - Headless turn for the board compiled into board_gen.h
+ * CS39002 Operating Systems Laboratory
+ *
+ * game_turn() with the classic rules, where the snakes and ladders walk
+ * is gen_chain() from ludo-gen instead of a loop over the board array,
+ * and the player and occupancy scans are inline instead of calls into
+ * simd.c. The board argument is ignored; it is there so game_turn_gen()
+ * can be used wherever a turn_fn is.
+ *
+ * Author: Ashutosh Sharma
+ * Roll: 23CS10005
+ */
+
+#include "board_gen.h"
+
+// game_next_player() without the call into simd.c
+static inline int next_player(struct game *g) {
+  for (int i = 1; i <= g->num_players; i++) {
+    int p = g->current + i;
+    if (p >= g->num_players)
+      p -= g->num_players;
+    if (g->pos[p] != FINISH_CELL) {
+      g->current = p;
+      return p;
+    }
+  }
+  return -1;
+}
+
+int game_turn_gen(const int *board, struct game *g, struct turn *t) {
+  int p = next_player(g);
+  if (p < 0)
+    return -1;
+
+  int pos = g->pos[p];
+  t->player = p;
+  t->from = pos;
+  t->to = pos;
+  t->hops = 0;
+  t->rank = 0;
+  t->captured = -1;
+  g->turns++;
+
+  int total = g->streams ? game_roll(&g->dice[p], t)
+                         : game_roll_alias(&g->rng, t);
+  if (total == 0) {
+    t->result = TURN_CANCELLED;
+    return 0;
+  }
+
+  int new_pos = pos + total;
+  if (new_pos > FINISH_CELL) {
+    t->result = TURN_OVERSHOOT;
+    return 0;
+  }
+  if (new_pos < FINISH_CELL && gen_occupied(g, p, new_pos)) {
+    t->result = TURN_BLOCKED;
+    return 0;
+  }
+
+  new_pos = gen_chain(g, p, new_pos, &t->hops);
+
+  g->pos[p] = new_pos;
+  t->to = new_pos;
+  t->result = TURN_MOVED;
+
+  if (new_pos == FINISH_CELL) {
+    t->rank = g->num_players - g->active + 1;
+    g->rank[p] = t->rank;
+    g->active--;
+  }
+  return 0;
+}
@@ -0,0 +1,35 @@
+/*
+ * futex.h - Futex wait/wake on words in shared memory
+ * CS39002 Operating Systems Laboratory
+ *
+ * Author: Ashutosh Sharma
+ * Roll: 23CS10005
+ */
+
+#ifndef FUTEX_H
+#define FUTEX_H
+
+#include <linux/futex.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+// sleep while *addr == val, at most timeout_ms (-1 = forever)
+static inline int futex_wait(_Atomic uint32_t *addr, uint32_t val,
+                             int timeout_ms) {
+  struct timespec ts, *tp = NULL;
+  if (timeout_ms >= 0) {
+    ts.tv_sec = timeout_ms / 1000;
+    ts.tv_nsec = (timeout_ms % 1000) * 1000000L;
+    tp = &ts;
+  }
+  return syscall(SYS_futex, (uint32_t *)addr, FUTEX_WAIT, val, tp, NULL, 0);
+}
+
+static inline void futex_wake(_Atomic uint32_t *addr) {
+  syscall(SYS_futex, (uint32_t *)addr, FUTEX_WAKE, INT32_MAX, NULL, NULL, 0);
+}
+
+#endif
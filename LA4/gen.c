@@ -0,0 +1,109 @@
+/*
+ * gen.c - ludo-gen: compile a board file into a C header
+ * CS39002 Operating Systems Laboratory
+ *
+ * Usage: ludo-gen [board] > board_gen.h
+ *
+ * Writes the board's jump and chain-length tables as constants, and
+ * gen_chain(), the snakes and ladders walk of game_turn() unrolled into a
+ * switch on the landing cell, with every jump target and every occupancy
+ * check written out as a constant. The occupancy checks are inline scalar
+ * loops, since the SIMD kernels in simd.c only pay off for many players
+ * and cannot take the cell as an immediate. engine_gen.c builds a turn function
+ * on it for that one board.
+ *
+ * Author: Ashutosh Sharma
+ * Roll: 23CS10005
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "engine.h"
+
+// cells visited from cell, as game_turn() walks them on an empty board
+int chain_of(const int *board, int cell, int *chain) {
+  unsigned char visited[BOARD_SIZE] = {0};
+  int n = 0;
+  while (cell > 0 && cell < FINISH_CELL && board[cell] != 0 &&
+         !visited[cell]) {
+    visited[cell] = 1;
+    cell += board[cell];
+    chain[n++] = cell;
+  }
+  return n;
+}
+
+void print_table(const char *type, const char *name, const int *values) {
+  printf("static const %s %s[BOARD_SIZE] = {", type, name);
+  for (int i = 0; i < BOARD_SIZE; i++)
+    printf("%s%d%s", i % 16 ? " " : "\n    ", values[i],
+           i + 1 < BOARD_SIZE ? "," : "");
+  printf("};\n\n");
+}
+
+int main(int argc, char *argv[]) {
+  const char *board_file = argc > 1 ? argv[1] : "ludo.txt";
+  int board[BOARD_SIZE], steps[BOARD_SIZE];
+  int chain[BOARD_SIZE];
+
+  if (argc > 2 || (argc > 1 && strcmp(argv[1], "-h") == 0)) {
+    printf("Usage: %s [board] > board_gen.h\n", argv[0]);
+    return argc > 2;
+  }
+  if (board_load(board, board_file) < 0)
+    return 1;
+
+  // FNV-1a of the jumps, so users can tell the header matches a board
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (int i = 0; i < BOARD_SIZE; i++) {
+    hash ^= (uint32_t)board[i];
+    hash *= 0x100000001b3ULL;
+  }
+  for (int i = 0; i < BOARD_SIZE; i++)
+    steps[i] = chain_of(board, i, chain);
+
+  printf("/*\n * board_gen.h - generated by ludo-gen from %s, do not edit\n"
+         " */\n\n",
+         board_file);
+  printf("#ifndef BOARD_GEN_H\n#define BOARD_GEN_H\n\n");
+  printf("#include \"engine.h\"\n\n");
+  printf("#define GEN_BOARD_FILE \"%s\"\n", board_file);
+  printf("#define GEN_BOARD_HASH 0x%016llxULL\n\n", (unsigned long long)hash);
+  print_table("signed char", "gen_jump", board);
+  print_table("unsigned char", "gen_steps", steps);
+
+  // inline so that the constant cells below fold into the compares
+  printf("// another player on cell (0 < cell < 100)\n");
+  printf("static inline int gen_occupied(const struct game *g, int player, "
+         "int cell) {\n"
+         "  for (int i = 0; i < g->num_players; i++)\n"
+         "    if (g->pos[i] == cell && i != player)\n"
+         "      return 1;\n"
+         "  return 0;\n}\n\n");
+
+  printf("// where player stops after landing on cell, hops taken in *hops\n");
+  printf("static inline int gen_chain(const struct game *g, int player, "
+         "int cell,\n                            int *hops) {\n");
+  printf("  if (gen_steps[cell] == 0)\n    return cell; // most landings\n");
+  printf("  switch (cell) {\n");
+  for (int c = 1; c < FINISH_CELL; c++) {
+    int n = chain_of(board, c, chain);
+    if (n == 0)
+      continue;
+    printf("  case %d:\n", c);
+    int at = c;
+    for (int h = 0; h < n; h++) {
+      // home and 100 are never occupied, so those hops need no check
+      if (chain[h] > 0 && chain[h] < FINISH_CELL)
+        printf("    if (gen_occupied(g, player, %d))\n"
+               "      return %d;\n",
+               chain[h], at);
+      printf("    ++*hops;\n");
+      at = chain[h];
+    }
+    printf("    return %d;\n", at);
+  }
+  printf("  default:\n    return cell;\n  }\n}\n\n#endif\n");
+  return 0;
+}
@@ -0,0 +1,112 @@
+/*
+ * logring.h - Lock-free narration rings for Snake Ludo
+ * CS39002 Operating Systems Laboratory
+ *
+ * The text the players print goes into a byte ring per player in the
+ * shared state instead of straight to the terminal; the PP drains them
+ * all (narrate.c). Each ring has one producer and one consumer. Entries
+ * are a header and the text, 8-byte aligned, and never wrap: one that
+ * does not fit before the end of the ring is preceded by a padding
+ * entry. A global sequence number puts entries from different rings
+ * back in the order they were written.
+ *
+ * Author: Ashutosh Sharma
+ * Roll: 23CS10005
+ */
+
+#ifndef LOGRING_H
+#define LOGRING_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "futex.h"
+
+#define LOG_RING_BYTES 16384 // per ring, power of two
+#define LOG_ENTRY_MAX 2048   // text in one entry, a turn's narration
+
+struct log_entry {
+  uint32_t seq; // order across the rings, 0 = padding to the end
+  uint16_t len; // bytes of text that follow
+  uint8_t pad[2];
+};
+
+struct log_ring {
+  _Atomic uint32_t head; // bytes written
+  char pad0[60];
+  _Atomic uint32_t tail;    // bytes drained (futex for a blocked producer)
+  _Atomic uint32_t waiting; // producer asleep on tail
+  _Atomic uint32_t dropped; // entries that found the ring full
+  char pad1[52];
+  char data[LOG_RING_BYTES];
+};
+
+static inline uint32_t log_entry_bytes(uint32_t len) {
+  return (sizeof(struct log_entry) + len + 7) & ~7u;
+}
+
+// producer side: append text as one entry numbered from *seq. When the
+// ring is full the entry is dropped (returns -1), or with block set the
+// producer waits for the consumer (returns the number of waits).
+static inline int log_push(struct log_ring *r, _Atomic uint32_t *seq,
+                           const char *text, uint16_t len, int block) {
+  uint32_t need = log_entry_bytes(len);
+  uint32_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+  uint32_t off = head & (LOG_RING_BYTES - 1);
+  uint32_t skip = off + need > LOG_RING_BYTES ? LOG_RING_BYTES - off : 0;
+  int waits = 0;
+
+  while (1) {
+    uint32_t tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+    if (head + skip + need - tail <= LOG_RING_BYTES)
+      break;
+    if (!block) {
+      atomic_fetch_add_explicit(&r->dropped, 1, memory_order_relaxed);
+      return -1;
+    }
+    // the consumer checks waiting after it moves tail, so either it
+    // wakes us or the futex sees tail moved
+    atomic_store(&r->waiting, 1);
+    futex_wait(&r->tail, tail, 100);
+    atomic_store(&r->waiting, 0);
+    waits++;
+  }
+
+  if (skip) {
+    struct log_entry pad = {0, 0, {0}};
+    memcpy(r->data + off, &pad, sizeof(pad));
+    off = 0;
+  }
+  struct log_entry e = {atomic_fetch_add(seq, 1) + 1, len, {0}};
+  memcpy(r->data + off, &e, sizeof(e));
+  memcpy(r->data + off + sizeof(e), text, len);
+  atomic_store_explicit(&r->head, head + skip + need, memory_order_release);
+  return waits;
+}
+
+// consumer side: the entry at the tail, skipping padding; NULL if empty
+static inline const struct log_entry *log_peek(struct log_ring *r) {
+  while (1) {
+    uint32_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+    uint32_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    if (tail == head)
+      return NULL;
+    uint32_t off = tail & (LOG_RING_BYTES - 1);
+    const struct log_entry *e = (const struct log_entry *)(r->data + off);
+    if (e->seq != 0)
+      return e;
+    atomic_store_explicit(&r->tail, tail + LOG_RING_BYTES - off,
+                          memory_order_release);
+  }
+}
+
+// consumer side: done with the entry log_peek() returned
+static inline void log_pop(struct log_ring *r, const struct log_entry *e) {
+  uint32_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+  atomic_store(&r->tail, tail + log_entry_bytes(e->len));
+  if (atomic_load(&r->waiting))
+    futex_wake(&r->tail);
+}
+
+#endif
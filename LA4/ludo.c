@@ -3,45 +3,92 @@
  * CS39002 Operating Systems Laboratory
  *
  * This process creates shared memory, spawns board and player processes,
- * and coordinates the game through signals and pipes.
+ * and coordinates the game through signals and shared memory: a turn is
+ * requested with SIGUSR1 to the PP, and the player's move comes back as a
+ * record on its ring, which the BP draws and the CP optionally logs. The
+ * FIFO is only used for the startup handshake. The shared segments
+ * are memfds that the children open through /proc, so nothing outlives
+ * the game even if it crashes.
+ *
+ * With --control the same commands can come over a Unix socket as well
+ * (control.h); the CP then waits for input with poll() on stdin and the
+ * socket together.
+ *
+ * Autoplay starts turns on a grid of absolute deadlines, one delay
+ * apart, so the time a turn takes does not add to the period. A turn
+ * that starts late is a miss; by default the slots it ran over are
+ * skipped, and with --catch-up they are played back to back instead.
  *
  * Author: Ashutosh Sharma
  * Roll: 23CS10005
  */
 
+#define _GNU_SOURCE // ppoll
+
 #include <errno.h>
 #include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/ipc.h>
-#include <sys/shm.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <time.h>
 #include <unistd.h>
 
-#define FIFO_NAME "/tmp/ludo_fifo"
+#include "affinity.h"
+#include "checkpoint.h"
+#include "control.h"
+#include "futex.h"
+#include "metrics.h"
+#include "replay.h"
+#include "shm.h"
+#include "state.h"
+#include "trace.h"
+
+#define FIFO_PREFIX "/tmp/ludo_fifo"
 
-#define MAX_PLAYERS 26
-#define BOARD_SIZE 101 // 0-100, index 0 unused
-#define SHM_KEY_BOARD 0x1234
-#define SHM_KEY_PLAYERS 0x5678
+// what wait_input() returned for
+#define WAIT_TIMEOUT 0
+#define WAIT_STDIN 1   // a line can be read
+#define WAIT_CHANGED 2 // a control request changed the mode or ended the game
+
+#define PACE_SLACK_NS 1000000ULL      // a turn this late missed its deadline
+#define PACE_REPORT_NS 10000000000ULL // autoplay rate report every 10 s
+
+#define BOARD_BYTES (BOARD_SIZE * sizeof(int))
+#define PLAYERS_BYTES sizeof(struct ludo_state)
 
 // global variables for cleanup
-int shm_id_board = -1;
-int shm_id_players = -1;
+int shm_fd_board = -1;
+int shm_fd_players = -1;
+char shm_board_path[SHM_PATH_LEN];
+char shm_players_path[SHM_PATH_LEN];
+char fifo_name[64];
 int *shm_board = NULL;
 int *shm_players = NULL;
+struct ludo_state *shm_state = NULL;
+struct ring_cursor log_cursors[MAX_PLAYERS];
+uint64_t log_lost[MAX_PLAYERS]; // records overwritten unlogged, reported
+FILE *log_fp = NULL;
 pid_t xbp_pid = -1; // XBP (xterm for board)
 pid_t xpp_pid = -1; // XPP (xterm for players)
 pid_t bp_pid = -1;  // BP (board process, child of XBP)
 pid_t pp_pid = -1;  // PP (player-parent, child of XPP)
 int pipe_fd = -1;
 int num_players = 0;
+int checkpoint_every = 10;
 volatile sig_atomic_t game_over = 0;
+long delay_us = 1000000; // autoplay period
+int autoplay = 0;
+int catch_up = 0; // play turns whose slots were missed instead of skipping
+const char *control_path = NULL;
+int control_changed = 0; // set by a control request the main loop must see
+const char *trace_file = NULL;
 
 void sigint_handler(int sig) { game_over = 1; }
 
@@ -99,40 +146,50 @@ int read_board_from_file(const char *filename) {
 
 // create shared memory segments
 int create_shared_memory() {
-  // create board shared memory
-  shm_id_board = shmget(SHM_KEY_BOARD, BOARD_SIZE * sizeof(int),
-                        IPC_CREAT | IPC_EXCL | 0666);
-  if (shm_id_board < 0) {
-    perror("shmget (board)");
+  // create board shared memory (sealed read-only once it is filled in)
+  shm_fd_board = shm_segment_create("ludo-board", BOARD_BYTES, SHM_SEALABLE);
+  if (shm_fd_board < 0)
     return -1;
-  }
 
-  shm_board = (int *)shmat(shm_id_board, NULL, 0);
-  if (shm_board == (int *)-1) {
-    perror("shmat (board)");
+  shm_board = (int *)shm_segment_map(shm_fd_board, BOARD_BYTES, 1);
+  if (shm_board == NULL)
     return -1;
-  }
 
   // create players shared memory (num_players + 1 for active count)
-  shm_id_players = shmget(SHM_KEY_PLAYERS, (MAX_PLAYERS + 1) * sizeof(int),
-                          IPC_CREAT | IPC_EXCL | 0666);
-  if (shm_id_players < 0) {
-    perror("shmget (players)");
+  shm_fd_players = shm_segment_create("ludo-players", PLAYERS_BYTES, 0);
+  if (shm_fd_players < 0)
     return -1;
-  }
 
-  shm_players = (int *)shmat(shm_id_players, NULL, 0);
-  if (shm_players == (int *)-1) {
-    perror("shmat (players)");
+  shm_state = (struct ludo_state *)shm_segment_map(shm_fd_players,
+                                                   PLAYERS_BYTES, 1);
+  if (shm_state == NULL)
     return -1;
-  }
+  shm_players = shm_state->players;
+
+  shm_segment_path(shm_fd_board, shm_board_path);
+  shm_segment_path(shm_fd_players, shm_players_path);
 
   // initialize player positions to 0 (home)
   for (int i = 0; i < MAX_PLAYERS; i++) {
     shm_players[i] = 0;
   }
   shm_players[num_players] = num_players; // active player count
+  shm_state->num_players = num_players;
+
+  return 0;
+}
 
+// seal the board so no process can change it after it is read
+int seal_board() {
+  munmap(shm_board, BOARD_BYTES);
+  shm_board = NULL;
+
+  if (shm_segment_seal(shm_fd_board) < 0)
+    return -1;
+
+  shm_board = (int *)shm_segment_map(shm_fd_board, BOARD_BYTES, 0);
+  if (shm_board == NULL)
+    return -1;
   return 0;
 }
 
@@ -140,6 +197,14 @@ int create_shared_memory() {
 void cleanup() {
   printf("\n+++ CP: Cleaning up...\n");
 
+  metrics_stop();
+  control_stop();
+  // a last checkpoint on the way out, unless a turn was cut short
+  if (shm_state != NULL &&
+      atomic_load(&shm_state->rendered) >= atomic_load(&shm_state->turn))
+    checkpoint_save(shm_state);
+  checkpoint_stop();
+
   if (pp_pid > 0) {
     printf("+++ CP: Sending SIGUSR2 to PP (PID %d)\n", pp_pid);
     kill(pp_pid, SIGUSR2);
@@ -162,24 +227,32 @@ void cleanup() {
     printf("+++ CP: XBP terminated\n");
   }
 
+  // every process that records is gone now
+  if (trace_buffers != NULL && trace_dump(trace_file) == 0)
+    printf("+++ CP: Trace written to %s (ludo-trace %s > trace.json)\n",
+           trace_file, trace_file);
+
   if (pipe_fd != -1)
     close(pipe_fd);
-  unlink(FIFO_NAME);
+  unlink(fifo_name);
 
-  if (shm_board != NULL && shm_board != (int *)-1) {
-    shmdt(shm_board);
+  if (shm_board != NULL) {
+    munmap(shm_board, BOARD_BYTES);
+  }
+  if (shm_state != NULL) {
+    munmap(shm_state, PLAYERS_BYTES);
   }
-  if (shm_players != NULL && shm_players != (int *)-1) {
-    shmdt(shm_players);
+  if (log_fp != NULL) {
+    fclose(log_fp);
   }
 
-  if (shm_id_board >= 0) {
-    shmctl(shm_id_board, IPC_RMID, NULL);
-    printf("+++ CP: Removed board shared memory\n");
+  if (shm_fd_board >= 0) {
+    close(shm_fd_board);
+    printf("+++ CP: Released board shared memory\n");
   }
-  if (shm_id_players >= 0) {
-    shmctl(shm_id_players, IPC_RMID, NULL);
-    printf("+++ CP: Removed players shared memory\n");
+  if (shm_fd_players >= 0) {
+    close(shm_fd_players);
+    printf("+++ CP: Released players shared memory\n");
   }
 
   printf("+++ CP: Cleanup complete. Goodbye!\n");
@@ -195,14 +268,12 @@ pid_t spawn_board_xterm() {
 
   if (pid == 0) {
     // child - exec xterm with board process
-    char shm_board_str[32], shm_players_str[32], num_players_str[16];
-    sprintf(shm_board_str, "%d", shm_id_board);
-    sprintf(shm_players_str, "%d", shm_id_players);
+    char num_players_str[16];
     sprintf(num_players_str, "%d", num_players);
 
     execlp("xterm", "xterm", "-T", "Board", "-fn", "fixed", "-geometry",
            "150x24+50+50", "-bg", "#003300", "-fg", "white", "-e", "./board",
-           shm_board_str, shm_players_str, num_players_str, FIFO_NAME,
+           shm_board_path, shm_players_path, num_players_str, fifo_name,
            (char *)NULL);
     perror("execlp (xterm board)");
     exit(1);
@@ -221,16 +292,14 @@ pid_t spawn_players_xterm() {
 
   if (pid == 0) {
     // child - exec xterm with players process
-    char shm_board_str[32], shm_players_str[32], num_players_str[16];
+    char num_players_str[16];
     char bp_pid_str[16];
-    sprintf(shm_board_str, "%d", shm_id_board);
-    sprintf(shm_players_str, "%d", shm_id_players);
     sprintf(num_players_str, "%d", num_players);
     sprintf(bp_pid_str, "%d", bp_pid);
 
     execlp("xterm", "xterm", "-T", "Players", "-fn", "fixed", "-geometry",
            "100x24+400+50", "-bg", "#000033", "-fg", "white", "-e", "./players",
-           shm_board_str, shm_players_str, num_players_str, FIFO_NAME,
+           shm_board_path, shm_players_path, num_players_str, fifo_name,
            bp_pid_str, (char *)NULL);
     perror("execlp (xterm players)");
     exit(1);
@@ -275,6 +344,338 @@ void wait_for_ack() {
   }
 }
 
+const char *result_names[] = {"move", "cancel", "overshoot", "blocked"};
+
+// append every new move record of a turn before below to the log, in
+// turn order. Records of later turns are left in the rings: while a batch
+// is being played, those turns may not all be published yet. Records a
+// player overwrote before they were read leave a "# N records lost"
+// line, which --verify-replay rejects.
+void log_moves(uint32_t below) {
+  // up to a full ring per player, too much for the stack; only the CP's
+  // main thread logs
+  static struct move_record recs[MAX_PLAYERS * RING_SIZE];
+  int n = 0;
+
+  for (int i = 0; i < num_players; i++) {
+    struct ring_cursor c = log_cursors[i];
+    while (ring_pop(&shm_state->rings[i], &c, &recs[n]) &&
+           recs[n].turn < below) {
+      log_cursors[i] = c;
+      n++;
+    }
+  }
+
+  // insertion sort by turn: each ring's records are in order already, so
+  // it merges runs. After a single turn there is one record, after a
+  // batch's log_moves() calls up to RING_SIZE per player
+  for (int i = 1; i < n; i++) {
+    struct move_record rec = recs[i];
+    int j = i - 1;
+    while (j >= 0 && recs[j].turn > rec.turn) {
+      recs[j + 1] = recs[j];
+      j--;
+    }
+    recs[j + 1] = rec;
+  }
+
+  for (int i = 0; i < num_players; i++) {
+    uint64_t lost = log_cursors[i].dropped - log_lost[i];
+    if (lost == 0)
+      continue;
+    fprintf(log_fp, "# %lu records lost for %c\n", lost, 'A' + i);
+    printf("+++ CP: Warning, %lu move records of %c were overwritten before "
+           "they were logged\n",
+           lost, 'A' + i);
+    stat_add(&shm_state->stats.records_lost, lost);
+    log_lost[i] = log_cursors[i].dropped;
+  }
+
+  for (int i = 0; i < n; i++) {
+    struct move_record *rec = &recs[i];
+    fprintf(log_fp, "%u %c %d ", rec->turn, 'A' + rec->player, rec->from);
+    for (int d = 0; d < rec->ndice; d++)
+      fprintf(log_fp, "%s%d", d ? "," : "", rec->dice[d]);
+    fprintf(log_fp, "%s %d %s %d %d\n", rec->ndice ? "" : "-", rec->to,
+            result_names[rec->result], rec->hops, rec->rank);
+  }
+  fflush(log_fp);
+}
+
+// drop the records after turn from a log, so that a resumed game does not
+// log those turns twice
+int trim_log(const char *path, uint32_t turn) {
+  char tmp_path[256];
+  char line[256];
+  snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+  FILE *in = fopen(path, "r");
+  if (in == NULL)
+    return errno == ENOENT ? 0 : -1;
+  FILE *out = fopen(tmp_path, "w");
+  if (out == NULL) {
+    perror("fopen (log)");
+    fclose(in);
+    return -1;
+  }
+  while (fgets(line, sizeof(line), in) != NULL) {
+    if (line[0] == '#' || strtoul(line, NULL, 10) <= turn)
+      fputs(line, out);
+  }
+  fclose(in);
+  if (fclose(out) != 0 || rename(tmp_path, path) < 0) {
+    perror("rename (log)");
+    unlink(tmp_path);
+    return -1;
+  }
+  return 0;
+}
+
+// ask the PP for one turn and wait until the BP has drawn it
+void play_turn() {
+  struct ludo_stats *stats = &shm_state->stats;
+  uint64_t start = stat_now_ns();
+  atomic_store_explicit(&stats->turn_start_ns, start, memory_order_relaxed);
+  uint32_t turn = atomic_fetch_add(&shm_state->turn, 1) + 1;
+  trace(TRACE_CP, TRACE_TURN, TRACE_BEGIN, turn);
+  trace(TRACE_CP, TRACE_SIGNAL, TRACE_MARK, turn);
+  kill(pp_pid, SIGUSR1);
+
+  uint32_t rendered;
+  trace(TRACE_CP, TRACE_ACK_WAIT, TRACE_BEGIN, turn);
+  while ((rendered = atomic_load_explicit(&shm_state->rendered,
+                                          memory_order_acquire)) < turn &&
+         !game_over) {
+    stat_add(&stats->ack_waits, 1);
+    futex_wait(&shm_state->rendered, rendered, 100);
+  }
+  trace(TRACE_CP, TRACE_ACK_WAIT, TRACE_END, turn);
+  stat_time(stats, STAGE_TURN, stat_now_ns() - start);
+
+  if (log_fp != NULL)
+    log_moves(UINT32_MAX);
+
+  // the turn is drawn and logged, nothing else touches the state now
+  if (turn % checkpoint_every == 0 || shm_players[num_players] <= 0)
+    checkpoint_save(shm_state);
+  control_notify();
+  trace(TRACE_CP, TRACE_TURN, TRACE_END, turn);
+}
+
+// have the PP play up to n turns back to back (next N, finish): one
+// signal for the batch, the BP drawing only every render_every turns and
+// the last one, and one wait for that last drawing. A batch that crosses
+// multiples of checkpoint_every is played in pieces ending on them, each
+// drawn and saved before the next is started.
+void play_turns(uint32_t n, uint32_t render_every) {
+  uint64_t start = stat_now_ns();
+  uint32_t first = atomic_load(&shm_state->turn);
+  uint32_t end = n > UINT32_MAX - first ? UINT32_MAX : first + n;
+  uint32_t last = first;
+
+  shm_state->render_every = render_every;
+  trace(TRACE_CP, TRACE_TURN, TRACE_BEGIN, first + 1);
+  trace(TRACE_CP, TRACE_ACK_WAIT, TRACE_BEGIN, first + 1);
+
+  while (last < end && !game_over) {
+    uint64_t boundary =
+        (uint64_t)(last / checkpoint_every + 1) * checkpoint_every;
+    uint32_t stop = boundary < end ? boundary : end;
+    atomic_store_explicit(&shm_state->batch_end, stop, memory_order_release);
+    trace(TRACE_CP, TRACE_SIGNAL, TRACE_MARK, last + 1);
+    kill(pp_pid, SIGUSR1);
+
+    // log along the way so that the rings are not overrun; the batch
+    // stops early when the last player finishes
+    while (!game_over) {
+      uint32_t events = atomic_load_explicit(&shm_state->events,
+                                             memory_order_acquire);
+      uint32_t turn = atomic_load_explicit(&shm_state->turn,
+                                           memory_order_acquire);
+      uint32_t rendered = atomic_load_explicit(&shm_state->rendered,
+                                               memory_order_acquire);
+      if (rendered >= stop ||
+          (shm_players[num_players] <= 0 && rendered >= turn))
+        break;
+      if (log_fp != NULL && turn < stop && shm_players[num_players] > 0) {
+        log_moves(turn); // turns before it are all published
+        futex_wait(&shm_state->events, events, 100);
+      } else {
+        stat_add(&shm_state->stats.ack_waits, 1);
+        futex_wait(&shm_state->rendered, rendered, 100);
+      }
+    }
+
+    last = atomic_load(&shm_state->turn);
+    if (log_fp != NULL)
+      log_moves(UINT32_MAX);
+    checkpoint_save(shm_state);
+    if (shm_players[num_players] <= 0)
+      break;
+  }
+
+  trace(TRACE_CP, TRACE_ACK_WAIT, TRACE_END, last);
+  atomic_store_explicit(&shm_state->batch_end, last, memory_order_release);
+  control_notify();
+  trace(TRACE_CP, TRACE_TURN, TRACE_END, last);
+
+  double secs = (stat_now_ns() - start) / 1e9;
+  printf("+++ CP: Played %u turns in %.3f s (%.0f turns/s)\n", last - first,
+         secs, secs > 0 ? (last - first) / secs : 0.0);
+}
+
+// autoplay pacing: deadlines and what was achieved since the last report
+struct pace {
+  uint64_t next_ns;  // deadline of the next turn, 0 to start from now
+  uint64_t since_ns; // start of the report window
+  uint64_t turns;
+  uint64_t misses;
+  uint64_t late_ns; // summed lateness of the turns in the window
+  uint64_t late_max_ns;
+} pace;
+
+// start the deadline grid again from now, e.g. after a change of delay
+void pace_reset() { pace.next_ns = 0; }
+
+void pace_report(uint64_t now) {
+  double secs = (now - pace.since_ns) / 1e9;
+  if (delay_us == 0) {
+    printf("+++ CP: Autoplay %.3f turns/s, unpaced\n", pace.turns / secs);
+  } else {
+    printf("+++ CP: Autoplay %.3f turns/s (target %.3f), %lu of %lu "
+           "deadlines missed, late by %.0f us on average, %.0f us at most\n",
+           pace.turns / secs, 1e6 / delay_us, pace.misses, pace.turns,
+           pace.turns ? pace.late_ns / 1e3 / pace.turns : 0.0,
+           pace.late_max_ns / 1e3);
+  }
+  fflush(stdout);
+  pace.since_ns = now;
+  pace.turns = pace.misses = pace.late_ns = pace.late_max_ns = 0;
+}
+
+// a turn starting now against the deadline pace.next_ns; moves the
+// deadline on to the next slot
+void pace_turn() {
+  uint64_t now = stat_now_ns();
+  uint64_t period = (uint64_t)delay_us * 1000;
+  uint64_t late = now > pace.next_ns ? now - pace.next_ns : 0;
+
+  if (pace.since_ns == 0)
+    pace.since_ns = now;
+  pace.turns++;
+  pace.late_ns += late;
+  if (late > pace.late_max_ns)
+    pace.late_max_ns = late;
+  if (period > 0 && late > PACE_SLACK_NS) {
+    pace.misses++;
+    stat_add(&shm_state->stats.pace_misses, 1);
+  }
+
+  pace.next_ns += period;
+  if (period == 0)
+    pace.next_ns = now; // no pacing, just as fast as turns go
+  else if (!catch_up && pace.next_ns <= now) // skip the slots already gone
+    pace.next_ns += ((now - pace.next_ns) / period + 1) * period;
+  if (now - pace.since_ns >= PACE_REPORT_NS)
+    pace_report(now);
+}
+
+// run a request from the control socket, as the prompt would the command
+int control_command(const struct ctl_request *req, void *payload,
+                    uint32_t *len) {
+  *len = 0;
+  switch (req->op) {
+  case CTL_NEXT:
+    if (game_over || shm_players[num_players] <= 0)
+      return CTL_EOVER;
+    if (req->arg <= 1)
+      play_turn();
+    else
+      play_turns(req->arg, 0);
+    if (shm_players[num_players] <= 0)
+      control_changed = 1;
+    return CTL_OK;
+  case CTL_DELAY:
+    delay_us = (req->arg > 1000000 ? 1000000 : req->arg) * 1000L;
+    pace_reset();
+    return CTL_OK;
+  case CTL_AUTOPLAY:
+    autoplay = req->arg != 0;
+    pace_reset();
+    control_changed = 1;
+    return CTL_OK;
+  case CTL_QUIT:
+    game_over = 1;
+    control_changed = 1;
+    return CTL_OK;
+  case CTL_STATE: {
+    struct ctl_state *st = payload;
+    memset(st, 0, sizeof(*st));
+    st->turn = atomic_load(&shm_state->turn);
+    st->delay_ms = delay_us / 1000;
+    st->num_players = num_players;
+    st->active = shm_players[num_players];
+    st->current = shm_state->current;
+    st->autoplay = autoplay;
+    for (int i = 0; i < num_players; i++)
+      st->pos[i] = shm_players[i];
+    *len = sizeof(*st);
+    return CTL_OK;
+  }
+  }
+  return CTL_EBADOP;
+}
+
+// wait until deadline (CLOCK_MONOTONIC ns, 0: no limit) for a line on
+// stdin, if want_stdin, serving control requests meanwhile; returns WAIT_*
+int wait_input(uint64_t deadline, int want_stdin) {
+  if (control_path == NULL) {
+    if (deadline == 0)
+      return WAIT_STDIN; // fgets() does the waiting
+    struct timespec ts = {deadline / 1000000000ULL, deadline % 1000000000ULL};
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) ==
+               EINTR &&
+           !game_over)
+      ;
+    return WAIT_TIMEOUT;
+  }
+
+  control_changed = 0;
+  while (1) {
+    struct pollfd fds[CTL_MAX_CLIENTS + 2];
+    int n = 0;
+    if (want_stdin)
+      fds[n++] = (struct pollfd){STDIN_FILENO, POLLIN, 0};
+    int first = n;
+    n += control_fds(fds + n);
+
+    struct timespec left, *timeout = NULL;
+    if (deadline != 0) {
+      uint64_t now = stat_now_ns();
+      if (now >= deadline)
+        return WAIT_TIMEOUT;
+      left.tv_sec = (deadline - now) / 1000000000ULL;
+      left.tv_nsec = (deadline - now) % 1000000000ULL;
+      timeout = &left;
+    }
+    if (ppoll(fds, n, timeout, NULL) < 0) {
+      if (errno != EINTR) {
+        perror("ppoll");
+        return WAIT_CHANGED;
+      }
+      if (game_over)
+        return WAIT_CHANGED;
+      continue;
+    }
+
+    control_serve(fds + first, n - first);
+    if (control_changed)
+      return WAIT_CHANGED;
+    if (want_stdin && fds[0].revents)
+      return WAIT_STDIN;
+  }
+}
+
 // read PID from pipe
 pid_t read_pid_from_pipe() {
   char buffer[64];
@@ -288,30 +689,199 @@ pid_t read_pid_from_pipe() {
 }
 
 void print_usage(char *prog_name) {
-  printf("Usage: %s <num_players>\n", prog_name);
+  printf("Usage: %s [options] <num_players>\n", prog_name);
+  printf("       %s [options] --resume <file>\n", prog_name);
+  printf("       %s --verify-replay <log> [log...]\n", prog_name);
   printf("  num_players: 2-%d\n", MAX_PLAYERS);
+  printf("\nOptions:\n");
+  printf("  --log <file>          - Write every move record to file\n");
+  printf("  --cpus-cp <list>      - Pin the CP to CPUs, e.g. 0 or 2-3,6\n");
+  printf("  --cpus-bp <list>      - Pin the BP\n");
+  printf("  --cpus-pp <list>      - Pin the PP\n");
+  printf("  --cpus-players <list> - Pin every player process\n");
+  printf("  --fifo <prio>         - Run CP/BP/PP/players under SCHED_FIFO\n");
+  printf("  --metrics <path|port> - Serve OpenMetrics on a Unix socket or on\n"
+         "                          127.0.0.1:<port>\n");
+  printf("  --seed <n>            - Dice seed; the same seed replays the same\n"
+         "                          dice (default: time and PID)\n");
+  printf("  --checkpoint <file>   - Save the game to file every few turns\n");
+  printf("  --checkpoint-every <n> - Turns between checkpoints (default: 10)\n");
+  printf("  --resume <file>       - Carry on from a checkpoint (num_players\n"
+         "                          may then be left out)\n");
+  printf("  --player-tasks        - Run players as coroutines inside the PP\n"
+         "                          instead of one process each\n");
+  printf("  --odds[=threads]      - Show live win odds on the board, from\n"
+         "                          rollouts on threads (default: 1)\n");
+  printf("  --control <path>      - Also take commands over a Unix socket\n"
+         "                          (binary protocol, see ludo-ctl)\n");
+  printf("  --catch-up            - In autoplay, play turns that missed their\n"
+         "                          slot back to back instead of skipping\n");
+  printf("  --quiet[=level]       - Players window: 1 (default) leaves only\n"
+         "                          starts and finishes, 2 leaves nothing\n");
+  printf("  --narration drop|block - When the players window falls behind,\n"
+         "                          drop narration (default) or make the\n"
+         "                          players wait for it\n");
+  printf("  --trace <file>        - Record every process's part in each turn\n"
+         "                          and write it to file at the end, for\n"
+         "                          ludo-trace to turn into Chrome JSON\n");
+  printf("  --verify-replay <log> - Replay --log files on the headless engine\n"
+         "                          with ludo.txt and report the first move\n"
+         "                          that differs\n");
   printf("\nCommands during interactive mode:\n");
   printf("  next          - Execute next player's move\n");
-  printf("  delay <ms>    - Set delay for autoplay (default: 1000)\n");
+  printf("  next <n> [k]  - Play n turns back to back, drawing the board\n"
+         "                  every k turns and after the last one\n");
+  printf("  finish [k]    - Play until every player has finished\n");
+  printf("  delay <ms>    - Set the autoplay period, e.g. 1000 or 0.5\n"
+         "                  (default: 1000)\n");
   printf("  autoplay      - Switch to autoplay mode\n");
   printf("  quit          - End the game\n");
 }
 
 int main(int argc, char *argv[]) {
-  int delay_ms = 1000;
-  int autoplay = 0;
+  const char *log_file = NULL;
+  const char *cpus_cp = NULL;
+  const char *metrics_at = NULL;
+  int fifo_prio = 0;
+  uint64_t seed = time(NULL) ^ getpid();
+  const char *checkpoint_file = NULL;
+  const char *resume_file = NULL;
+  const char *replay_log = NULL;
+  static struct checkpoint resume;
 
   // parse arguments
-  if (argc < 2) {
-    print_usage(argv[0]);
-    return 1;
+  static struct option long_options[] = {
+      {"log", required_argument, 0, 'l'},
+      {"cpus-cp", required_argument, 0, 'C'},
+      {"cpus-bp", required_argument, 0, 'B'},
+      {"cpus-pp", required_argument, 0, 'P'},
+      {"cpus-players", required_argument, 0, 'Y'},
+      {"fifo", required_argument, 0, 'F'},
+      {"metrics", required_argument, 0, 'M'},
+      {"seed", required_argument, 0, 'S'},
+      {"checkpoint", required_argument, 0, 'K'},
+      {"checkpoint-every", required_argument, 0, 'k'},
+      {"resume", required_argument, 0, 'R'},
+      {"verify-replay", required_argument, 0, 'V'},
+      {"player-tasks", no_argument, 0, 'T'},
+      {"odds", optional_argument, 0, 'O'},
+      {"control", required_argument, 0, 'c'},
+      {"catch-up", no_argument, 0, 'U'},
+      {"quiet", optional_argument, 0, 'q'},
+      {"narration", required_argument, 0, 'N'},
+      {"trace", required_argument, 0, 'Z'},
+      {"help", no_argument, 0, 'h'},
+      {0, 0, 0, 0}};
+  int opt;
+  while ((opt = getopt_long(argc, argv, "h", long_options, NULL)) != -1) {
+    switch (opt) {
+    case 'l':
+      log_file = optarg;
+      break;
+    case 'C':
+      cpus_cp = optarg;
+      break;
+    case 'B':
+      sched_export("BP", optarg);
+      break;
+    case 'P':
+      sched_export("PP", optarg);
+      break;
+    case 'Y':
+      sched_export("PLAYERS", optarg);
+      break;
+    case 'F':
+      fifo_prio = atoi(optarg);
+      setenv("LUDO_SCHED_FIFO", optarg, 1);
+      break;
+    case 'M':
+      metrics_at = optarg;
+      break;
+    case 'S':
+      seed = strtoull(optarg, NULL, 0);
+      break;
+    case 'K':
+      checkpoint_file = optarg;
+      break;
+    case 'k':
+      checkpoint_every = atoi(optarg);
+      break;
+    case 'R':
+      resume_file = optarg;
+      break;
+    case 'V':
+      replay_log = optarg;
+      break;
+    case 'T':
+      setenv("LUDO_PLAYER_TASKS", "1", 1);
+      break;
+    case 'O':
+      setenv("LUDO_ODDS", optarg != NULL ? optarg : "1", 1);
+      break;
+    case 'c':
+      control_path = optarg;
+      break;
+    case 'U':
+      catch_up = 1;
+      break;
+    case 'q':
+      setenv("LUDO_QUIET", optarg != NULL ? optarg : "1", 1);
+      break;
+    case 'N':
+      if (strcmp(optarg, "drop") != 0 && strcmp(optarg, "block") != 0) {
+        fprintf(stderr, "Error: --narration takes drop or block\n");
+        return 1;
+      }
+      setenv("LUDO_NARRATION", optarg, 1);
+      break;
+    case 'Z':
+      trace_file = optarg;
+      break;
+    default:
+      print_usage(argv[0]);
+      return opt == 'h' ? 0 : 1;
+    }
+  }
+
+  // no game: every remaining argument is another log to check
+  if (replay_log != NULL) {
+    int nlogs = argc - optind + 1;
+    char *logs[nlogs];
+    logs[0] = (char *)replay_log;
+    for (int i = 1; i < nlogs; i++)
+      logs[i] = argv[optind + i - 1];
+    int threads = sysconf(_SC_NPROCESSORS_ONLN);
+    return replay_verify("ludo.txt", logs, nlogs, threads) ? 1 : 0;
   }
 
-  num_players = atoi(argv[1]);
+  if (resume_file != NULL) {
+    if (checkpoint_load(resume_file, &resume) < 0)
+      return 1;
+    if (optind < argc && atoi(argv[optind]) != resume.num_players) {
+      fprintf(stderr, "Error: %s is a %d-player game\n", resume_file,
+              resume.num_players);
+      return 1;
+    }
+    num_players = resume.num_players;
+    seed = resume.seed;
+    // keep saving where we resumed from unless told otherwise
+    if (checkpoint_file == NULL)
+      checkpoint_file = resume_file;
+  } else {
+    if (optind >= argc) {
+      print_usage(argv[0]);
+      return 1;
+    }
+    num_players = atoi(argv[optind]);
+  }
   if (num_players < 2 || num_players > MAX_PLAYERS) {
     fprintf(stderr, "Error: num_players must be 2-%d\n", MAX_PLAYERS);
     return 1;
   }
+  if (checkpoint_every < 1) {
+    fprintf(stderr, "Error: --checkpoint-every must be at least 1\n");
+    return 1;
+  }
 
   printf("\n");
   printf("------------------------------------------------------\n");
@@ -328,28 +898,91 @@ int main(int argc, char *argv[]) {
   if (check_xterm() < 0)
     return 1;
 
-  unlink(FIFO_NAME); // remove if exists
-  if (mkfifo(FIFO_NAME, 0666) < 0) {
+  // one FIFO per coordinator so several games can run side by side
+  snprintf(fifo_name, sizeof(fifo_name), "%s.%d", FIFO_PREFIX, getpid());
+  unlink(fifo_name); // remove if exists
+  if (mkfifo(fifo_name, 0666) < 0) {
     perror("mkfifo");
     return 1;
   }
-  printf("+++ CP: Created FIFO %s\n", FIFO_NAME);
+  printf("+++ CP: Created FIFO %s\n", fifo_name);
 
   printf("+++ CP: Creating shared memory segments...\n");
   if (create_shared_memory() < 0) {
     fprintf(stderr, "Failed to create shared memory\n");
+    cleanup();
     return 1;
   }
-  printf("+++ CP: Shared memory created (MB=%d, MP=%d)\n", shm_id_board,
-         shm_id_players);
+  printf("+++ CP: Shared memory created (MB=%s, MP=%s)\n", shm_board_path,
+         shm_players_path);
+  if (trace_file != NULL) {
+    if (trace_create() < 0) {
+      cleanup();
+      return 1;
+    }
+    trace_claim(TRACE_CP);
+  }
 
-  printf("+++ CP: Reading board from ludo.txt...\n");
-  if (read_board_from_file("ludo.txt") < 0) {
-    fprintf(stderr, "Failed to read board file\n");
+  if (resume_file != NULL) {
+    // the board comes from the checkpoint so that it cannot change under
+    // a game in progress
+    memcpy(shm_board, resume.board, BOARD_BYTES);
+  } else {
+    printf("+++ CP: Reading board from ludo.txt...\n");
+    if (read_board_from_file("ludo.txt") < 0) {
+      fprintf(stderr, "Failed to read board file\n");
+      cleanup();
+      return 1;
+    }
+  }
+  if (seal_board() < 0) {
     cleanup();
     return 1;
   }
-  printf("+++ CP: Board initialized\n");
+  printf("+++ CP: Board initialized and sealed read-only\n");
+
+  char seed_str[32];
+  snprintf(seed_str, sizeof(seed_str), "%llu", (unsigned long long)seed);
+  if (resume_file != NULL) {
+    checkpoint_restore(&resume, shm_state);
+    printf("+++ CP: Resumed from %s after turn %u (%d players active)\n",
+           resume_file, resume.turn, shm_players[num_players]);
+  } else {
+    // each player rolls from its own stream of the seed; see rng.h
+    shm_state->current = -1;
+    for (int i = 0; i < num_players; i++)
+      shm_state->dice[i] = rng_stream(seed, i);
+  }
+  printf("+++ CP: Dice seed %s\n", seed_str);
+
+  if (checkpoint_file != NULL) {
+    if (checkpoint_start(checkpoint_file, shm_board, num_players, seed) < 0) {
+      cleanup();
+      return 1;
+    }
+    printf("+++ CP: Checkpointing to %s every %d turns\n", checkpoint_file,
+           checkpoint_every);
+  }
+
+  if (log_file != NULL) {
+    // a resumed game carries on in the log it was started with, minus
+    // any turns played after the checkpoint
+    if (resume_file != NULL && trim_log(log_file, resume.turn) < 0) {
+      cleanup();
+      return 1;
+    }
+    log_fp = fopen(log_file, resume_file != NULL ? "a" : "w");
+    if (log_fp == NULL) {
+      perror("fopen (log)");
+      cleanup();
+      return 1;
+    }
+    if (ftell(log_fp) == 0) {
+      fprintf(log_fp, "# seed %s players %d\n", seed_str, num_players);
+      fprintf(log_fp, "# turn player from dice to result hops rank\n");
+    }
+    printf("+++ CP: Logging moves to %s\n", log_file);
+  }
 
   printf("+++ CP: Spawning board window...\n");
   xbp_pid = spawn_board_xterm();
@@ -360,7 +993,7 @@ int main(int argc, char *argv[]) {
   printf("+++ CP: XBP spawned (PID %d)\n", xbp_pid);
 
   printf("+++ CP: Waiting for Board process to connect...\n");
-  pipe_fd = open(FIFO_NAME, O_RDONLY);
+  pipe_fd = open(fifo_name, O_RDONLY);
   if (pipe_fd < 0) {
     perror("open fifo");
     cleanup();
@@ -381,31 +1014,64 @@ int main(int argc, char *argv[]) {
   pp_pid = read_pid_from_pipe();
   printf("+++ CP: PP started (PID %d)\n", pp_pid);
 
+  if (metrics_at != NULL) {
+    if (metrics_start(metrics_at, shm_state, num_players, &bp_pid, &pp_pid) <
+        0) {
+      cleanup();
+      return 1;
+    }
+    printf("+++ CP: Serving metrics on %s\n", metrics_at);
+  }
+
+  // pin ourselves only now, so the xterms and the metrics thread were not
+  // pinned along with us
+  if (cpus_cp != NULL || fifo_prio > 0) {
+    sched_setup("CP", cpus_cp, fifo_prio);
+    printf("+++ CP: Scheduling: cpus=%s fifo=%d\n", cpus_cp ? cpus_cp : "any",
+           fifo_prio);
+  }
+
+  if (control_path != NULL) {
+    if (control_start(control_path, shm_state, control_command) < 0) {
+      cleanup();
+      return 1;
+    }
+    // unbuffered, so that poll() on stdin sees every line still unread
+    setvbuf(stdin, NULL, _IONBF, 0);
+    printf("+++ CP: Taking commands on %s\n", control_path);
+  }
+
   printf("+++ CP: Waiting for initial board...\n");
   wait_for_ack();
   printf("+++ CP: Game ready!\n\n");
 
-  printf("Commands: next, delay <ms>, autoplay, quit\n");
+  printf("Commands: next [n [k]], finish [k], delay <ms>, autoplay, quit\n");
   printf("-----------------------------------------------------\n\n");
 
   char input[128];
-  struct timespec ts;
+  int prompted = 0;
 
   while (!game_over && shm_players[num_players] > 0) {
     if (autoplay) {
-      ts.tv_sec = delay_ms / 1000;
-      ts.tv_nsec = (delay_ms % 1000) * 1000000L;
-      nanosleep(&ts, NULL);
+      if (pace.next_ns == 0)
+        pace.next_ns = stat_now_ns() + delay_us * 1000ULL;
+      if (wait_input(pace.next_ns, 0) != WAIT_TIMEOUT)
+        continue;
 
       if (game_over || shm_players[num_players] <= 0)
         break;
 
-      kill(pp_pid, SIGUSR1);
-
-      wait_for_ack();
+      pace_turn();
+      play_turn();
     } else {
-      printf("+++ CP: Enter command: ");
-      fflush(stdout);
+      if (!prompted) {
+        printf("+++ CP: Enter command: ");
+        fflush(stdout);
+        prompted = 1;
+      }
+      if (wait_input(0, 1) != WAIT_STDIN)
+        continue;
+      prompted = 0;
 
       if (fgets(input, sizeof(input), stdin) == NULL) {
         break;
@@ -418,16 +1084,28 @@ int main(int argc, char *argv[]) {
         game_over = 1;
         break;
       } else if (strcmp(input, "next") == 0) {
-        kill(pp_pid, SIGUSR1);
-        wait_for_ack();
+        play_turn();
+      } else if (strncmp(input, "next ", 5) == 0) {
+        unsigned long n = 0, every = 0;
+        if (sscanf(input + 5, "%lu %lu", &n, &every) < 1 || n == 0)
+          printf("+++ CP: Usage: next <n> [k]\n");
+        else
+          play_turns(n > UINT32_MAX ? UINT32_MAX : n, every);
+      } else if (strcmp(input, "finish") == 0 ||
+                 strncmp(input, "finish ", 7) == 0) {
+        unsigned long every = 0;
+        sscanf(input + 6, "%lu", &every);
+        play_turns(UINT32_MAX, every);
       } else if (strncmp(input, "delay ", 6) == 0) {
-        delay_ms = atoi(input + 6);
-        if (delay_ms < 0)
-          delay_ms = 0;
-        printf("+++ CP: Delay set to %d ms\n", delay_ms);
+        double ms = atof(input + 6);
+        delay_us = ms > 0 ? (long)(ms * 1000 + 0.5) : 0;
+        pace_reset();
+        printf("+++ CP: Delay set to %.3f ms\n", delay_us / 1000.0);
       } else if (strcmp(input, "autoplay") == 0) {
         autoplay = 1;
-        printf("+++ CP: Switching to autoplay mode (delay: %d ms)\n", delay_ms);
+        pace_reset();
+        printf("+++ CP: Switching to autoplay mode (delay: %.3f ms)\n",
+               delay_us / 1000.0);
       } else if (strlen(input) > 0) {
         printf("+++ CP: Unknown command '%s'\n", input);
       }
@@ -441,9 +1119,12 @@ int main(int argc, char *argv[]) {
     printf("╚══════════════════════════════════════════════════════╝\n\n");
   }
 
+  if (autoplay && pace.turns > 0)
+    pace_report(stat_now_ns());
   printf("+++ CP: Press ENTER to exit...");
   fflush(stdout);
-  getchar(); // wait for enter
+  if (wait_input(0, 1) == WAIT_STDIN)
+    getchar(); // wait for enter
 
   cleanup();
 
@@ -0,0 +1,302 @@
+/*
+ * metrics.c - OpenMetrics exporter for the coordinator
+ * CS39002 Operating Systems Laboratory
+ *
+ * A thread of the CP serves the shared counters as OpenMetrics text over
+ * HTTP on a Unix socket or a localhost port. It only reads atomics, so
+ * scraping never touches the turn loop. Try:
+ *   curl --unix-socket /tmp/ludo.metrics http://localhost/metrics
+ *
+ * Author: Ashutosh Sharma
+ * Roll: 23CS10005
+ */
+
+#include "metrics.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define RATE_INTERVAL_MS 1000
+
+static struct ludo_state *m_state = NULL;
+static int m_num_players = 0;
+static pid_t *m_bp_pid = NULL;
+static pid_t *m_pp_pid = NULL;
+static int m_listen_fd = -1;
+static char m_socket_path[108] = "";
+static volatile int m_stopping = 0;
+static pthread_t m_thread;
+static double m_turn_rate = 0.0;
+
+static const char *m_stage_names[NUM_STAGES] = {"dispatch", "move",
+                                                "render", "turn"};
+
+static uint64_t metric_load(_Atomic uint64_t *counter) {
+  return atomic_load_explicit(counter, memory_order_relaxed);
+}
+
+static int process_up(pid_t pid) { return pid > 0 && kill(pid, 0) == 0; }
+
+static void write_counter(FILE *out, const char *name, const char *help,
+                          uint64_t value) {
+  fprintf(out, "# TYPE %s counter\n# HELP %s %s\n%s_total %lu\n", name, name,
+          help, name, value);
+}
+
+// bucket b holds [2^(b-1), 2^b) ns, so its inclusive bound is 2^b - 1 ns;
+// the last one also takes everything longer and only fits under +Inf
+static void write_histogram(FILE *out, int stage) {
+  struct stage_stat *s = &m_state->stats.stages[stage];
+  uint64_t cumulative = 0;
+
+  for (int b = 0; b < STAT_BUCKETS - 1; b++) {
+    cumulative += metric_load(&s->hist[b]);
+    fprintf(out, "ludo_stage_latency_seconds_bucket{stage=\"%s\",le=\"%.9f\"} "
+                 "%lu\n",
+            m_stage_names[stage], (double)((1ULL << b) - 1) / 1e9, cumulative);
+  }
+  cumulative += metric_load(&s->hist[STAT_BUCKETS - 1]);
+  fprintf(out,
+          "ludo_stage_latency_seconds_bucket{stage=\"%s\",le=\"+Inf\"} %lu\n",
+          m_stage_names[stage], cumulative);
+  fprintf(out, "ludo_stage_latency_seconds_sum{stage=\"%s\"} %.9f\n",
+          m_stage_names[stage], metric_load(&s->total_ns) / 1e9);
+  fprintf(out, "ludo_stage_latency_seconds_count{stage=\"%s\"} %lu\n",
+          m_stage_names[stage], cumulative);
+}
+
+// render every metric into out
+static void write_metrics(FILE *out) {
+  struct ludo_stats *st = &m_state->stats;
+
+  write_counter(out, "ludo_turns", "Turns played", metric_load(&st->turns));
+  fprintf(out, "# TYPE ludo_turn_rate gauge\n"
+               "# HELP ludo_turn_rate Turns per second over the last second\n"
+               "ludo_turn_rate %.3f\n",
+          m_turn_rate);
+  fprintf(out, "# TYPE ludo_players_active gauge\n"
+               "# HELP ludo_players_active Players not yet at 100\n"
+               "ludo_players_active %d\n",
+          m_state->players[m_num_players]);
+  fprintf(out, "# TYPE ludo_players gauge\n"
+               "# HELP ludo_players Players in the game\n"
+               "ludo_players %d\n",
+          m_num_players);
+  write_counter(out, "ludo_players_finished", "Players that reached 100",
+                metric_load(&st->finished));
+
+  fprintf(out, "# TYPE ludo_moves_rejected counter\n"
+               "# HELP ludo_moves_rejected "
+               "Turns that did not move the token\n");
+  fprintf(out, "ludo_moves_rejected_total{reason=\"three_sixes\"} %lu\n",
+          metric_load(&st->cancelled));
+  fprintf(out, "ludo_moves_rejected_total{reason=\"overshoot\"} %lu\n",
+          metric_load(&st->overshoot));
+  fprintf(out, "ludo_moves_rejected_total{reason=\"occupied\"} %lu\n",
+          metric_load(&st->blocked));
+  write_counter(out, "ludo_chain_blocks",
+                "Snake/ladder hops stopped by an occupied cell",
+                metric_load(&st->chain_blocked));
+
+  fprintf(out, "# TYPE ludo_hops counter\n"
+               "# HELP ludo_hops Snake and ladder hops taken\n");
+  fprintf(out, "ludo_hops_total{kind=\"ladder\"} %lu\n",
+          metric_load(&st->ladders));
+  fprintf(out, "ludo_hops_total{kind=\"snake\"} %lu\n",
+          metric_load(&st->snakes));
+
+  write_counter(out, "ludo_redraws", "Board redraws",
+                metric_load(&st->redraws));
+  write_counter(out, "ludo_ack_waits", "Times the CP slept waiting for the BP",
+                metric_load(&st->ack_waits));
+  write_counter(out, "ludo_pace_misses",
+                "Autoplay turns that started past their deadline",
+                metric_load(&st->pace_misses));
+  write_counter(out, "ludo_log_dropped",
+                "Narration entries dropped because a log ring was full",
+                metric_load(&st->log_dropped));
+  write_counter(out, "ludo_log_waits",
+                "Times a player waited for the log writer",
+                metric_load(&st->log_waits));
+  write_counter(out, "ludo_records_lost",
+                "Move records overwritten before the CP could log them",
+                metric_load(&st->records_lost));
+
+  fprintf(out, "# TYPE ludo_stage_latency_seconds histogram\n"
+               "# HELP ludo_stage_latency_seconds "
+               "Latency of each turn stage\n");
+  for (int i = 0; i < NUM_STAGES; i++)
+    write_histogram(out, i);
+
+  fprintf(out, "# TYPE ludo_process_up gauge\n"
+               "# HELP ludo_process_up Whether a game process is alive\n");
+  fprintf(out, "ludo_process_up{process=\"cp\"} 1\n");
+  fprintf(out, "ludo_process_up{process=\"bp\"} %d\n", process_up(*m_bp_pid));
+  fprintf(out, "ludo_process_up{process=\"pp\"} %d\n", process_up(*m_pp_pid));
+  fprintf(out, "# EOF\n");
+}
+
+static void write_all(int fd, const char *buffer, size_t len) {
+  while (len > 0) {
+    ssize_t n = write(fd, buffer, len);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return;
+    buffer += n;
+    len -= n;
+  }
+}
+
+// answer one HTTP request; any path gets the metrics
+static void serve_client(int fd) {
+  char request[1024];
+  struct pollfd pfd = {fd, POLLIN, 0};
+
+  // don't let a silent client hold the thread
+  if (poll(&pfd, 1, 1000) <= 0 || read(fd, request, sizeof(request)) <= 0) {
+    close(fd);
+    return;
+  }
+
+  char *body = NULL;
+  size_t body_len = 0;
+  FILE *out = open_memstream(&body, &body_len);
+  write_metrics(out);
+  fclose(out);
+
+  char header[256];
+  int n = snprintf(header, sizeof(header),
+                   "HTTP/1.0 200 OK\r\n"
+                   "Content-Type: application/openmetrics-text; "
+                   "version=1.0.0; charset=utf-8\r\n"
+                   "Content-Length: %zu\r\n\r\n",
+                   body_len);
+  write_all(fd, header, n);
+  write_all(fd, body, body_len);
+  free(body);
+  close(fd);
+}
+
+static void *metrics_thread(void *arg) {
+  uint64_t last_turns = metric_load(&m_state->stats.turns);
+  uint64_t last_ns = stat_now_ns();
+  struct pollfd pfd = {m_listen_fd, POLLIN, 0};
+
+  while (!m_stopping) {
+    int ready = poll(&pfd, 1, RATE_INTERVAL_MS);
+
+    uint64_t now = stat_now_ns();
+    if (now - last_ns >= RATE_INTERVAL_MS * 1000000ULL) {
+      uint64_t turns = metric_load(&m_state->stats.turns);
+      m_turn_rate = (turns - last_turns) * 1e9 / (now - last_ns);
+      last_turns = turns;
+      last_ns = now;
+    }
+
+    if (ready > 0 && (pfd.revents & POLLIN)) {
+      int fd = accept(m_listen_fd, NULL, NULL);
+      if (fd >= 0)
+        serve_client(fd);
+    }
+  }
+  return NULL;
+}
+
+static int listen_unix(const char *path) {
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    perror("socket (metrics)");
+    return -1;
+  }
+
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+  unlink(path);
+  if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    perror("bind (metrics)");
+    close(fd);
+    return -1;
+  }
+  strncpy(m_socket_path, path, sizeof(m_socket_path) - 1);
+  return fd;
+}
+
+static int listen_tcp(int port) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) {
+    perror("socket (metrics)");
+    return -1;
+  }
+
+  int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    perror("bind (metrics)");
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+static void close_listener() {
+  close(m_listen_fd);
+  m_listen_fd = -1;
+  if (m_socket_path[0])
+    unlink(m_socket_path);
+  m_socket_path[0] = '\0';
+}
+
+int metrics_start(const char *where, struct ludo_state *state, int num_players,
+                  pid_t *bp_pid, pid_t *pp_pid) {
+  m_state = state;
+  m_num_players = num_players;
+  m_bp_pid = bp_pid;
+  m_pp_pid = pp_pid;
+
+  const char *p = where;
+  while (isdigit((unsigned char)*p))
+    p++;
+  m_listen_fd = (*p == '\0') ? listen_tcp(atoi(where)) : listen_unix(where);
+  if (m_listen_fd < 0)
+    return -1;
+
+  if (listen(m_listen_fd, 16) < 0) {
+    perror("listen (metrics)");
+    close_listener();
+    return -1;
+  }
+
+  if (pthread_create(&m_thread, NULL, metrics_thread, NULL) != 0) {
+    fprintf(stderr, "Failed to start metrics thread\n");
+    close_listener();
+    return -1;
+  }
+  return 0;
+}
+
+void metrics_stop() {
+  if (m_listen_fd < 0)
+    return;
+  m_stopping = 1;
+  pthread_join(m_thread, NULL);
+  close_listener();
+}
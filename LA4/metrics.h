@@ -0,0 +1,21 @@
+/*
+ * metrics.h - OpenMetrics exporter for the coordinator
+ * CS39002 Operating Systems Laboratory
+ *
+ * Author: Ashutosh Sharma
+ * Roll: 23CS10005
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <sys/types.h>
+
+#include "state.h"
+
+// where is a Unix socket path, or a TCP port number on 127.0.0.1
+int metrics_start(const char *where, struct ludo_state *state, int num_players,
+                  pid_t *bp_pid, pid_t *pp_pid);
+void metrics_stop();
+
+#endif
@@ -0,0 +1,194 @@
+/*
+ * narrate.c - Player narration through the shared log rings
+ * CS39002 Operating Systems Laboratory
+ *
+ * A player used to print and flush each die as it went, so a terminal
+ * that was slow to take the text held up its turn. Now it builds the
+ * narration of a turn in memory and pushes it to its ring (logring.h)
+ * as one entry just before it publishes the move, and a writer thread
+ * in the PP merges the rings back into order and writes them out in
+ * batches. If the terminal falls so far behind that a ring fills up,
+ * the entry is dropped and counted, or with LUDO_NARRATION=block the
+ * player waits for the writer, which keeps every line.
+ *
+ * The writer sleeps on the events futex, which every published move
+ * wakes anyway, so pushing an entry costs the player no system call.
+ *
+ * Author: Ashutosh Sharma
+ * Roll: 23CS10005
+ */
+
+#include "narrate.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "trace.h"
+
+#define LOG_WRITE_BYTES 32768 // gathered before each write()
+#define LOG_IDLE_MS 50        // PP messages wait at most this long
+
+static struct ludo_state *n_state = NULL;
+static int n_level = LOG_MOVES;
+static int n_block = 0;
+static char n_buf[MAX_PLAYERS + 1][LOG_ENTRY_MAX]; // entries being built
+static int n_len[MAX_PLAYERS + 1];
+static pthread_t n_writer;
+static int n_running = 0;
+static volatile int n_stopping = 0;
+
+void narrate_init(struct ludo_state *state) {
+  const char *quiet = getenv("LUDO_QUIET");
+  const char *policy = getenv("LUDO_NARRATION");
+
+  n_state = state;
+  n_level = LOG_MOVES - (quiet != NULL ? atoi(quiet) : 0);
+  n_block = policy != NULL && strcmp(policy, "block") == 0;
+}
+
+void narrate(int who, int level, const char *fmt, ...) {
+  if (level > n_level)
+    return;
+
+  int room = LOG_ENTRY_MAX - n_len[who];
+  va_list ap;
+  va_start(ap, fmt);
+  int n = vsnprintf(n_buf[who] + n_len[who], room, fmt, ap);
+  va_end(ap);
+  if (n > 0)
+    n_len[who] += n < room ? n : room - 1; // cut short if over the max
+}
+
+void narrate_flush(int who) {
+  if (n_len[who] == 0)
+    return;
+  int waits = log_push(&n_state->logs[who], &n_state->log_seq, n_buf[who],
+                       n_len[who], n_block);
+  if (waits < 0)
+    stat_add(&n_state->stats.log_dropped, 1);
+  else if (waits > 0)
+    stat_add(&n_state->stats.log_waits, waits);
+  n_len[who] = 0;
+}
+
+static void write_all(const char *buffer, size_t len) {
+  uint32_t turn = atomic_load(&n_state->turn);
+
+  trace(TRACE_LOG, TRACE_WRITE, TRACE_BEGIN, turn);
+  while (len > 0) {
+    ssize_t n = write(STDOUT_FILENO, buffer, len);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      break; // the terminal is gone, nothing to be done
+    buffer += n;
+    len -= n;
+  }
+  trace(TRACE_LOG, TRACE_WRITE, TRACE_END, turn);
+}
+
+// write out every entry in the rings, oldest first; *next is the
+// sequence number expected next
+static void drain(uint32_t *next, uint32_t *dropped) {
+  static char out[LOG_WRITE_BYTES];
+  size_t len = 0;
+  int rescanned = 0;
+
+  while (1) {
+    struct log_ring *ring = NULL;
+    const struct log_entry *e = NULL;
+    for (int i = 0; i <= MAX_PLAYERS; i++) {
+      const struct log_entry *head = log_peek(&n_state->logs[i]);
+      if (head != NULL && (e == NULL || (int32_t)(head->seq - e->seq) < 0)) {
+        ring = &n_state->logs[i];
+        e = head;
+      }
+    }
+    if (e == NULL)
+      break;
+    // the one expected may have been pushed to a ring already passed
+    if (e->seq != *next && !rescanned) {
+      rescanned = 1;
+      continue;
+    }
+    rescanned = 0;
+
+    if (len + e->len > sizeof(out)) {
+      write_all(out, len);
+      len = 0;
+    }
+    memcpy(out + len, e + 1, e->len);
+    len += e->len;
+    *next = e->seq + 1;
+    log_pop(ring, e);
+  }
+
+  for (int i = 0; i <= MAX_PLAYERS; i++) {
+    uint32_t d = atomic_load_explicit(&n_state->logs[i].dropped,
+                                      memory_order_relaxed);
+    if (d == dropped[i])
+      continue;
+    if (len + 128 > sizeof(out)) {
+      write_all(out, len);
+      len = 0;
+    }
+    if (i == NARRATE_PP)
+      len += sprintf(out + len, "+++ PP: %u of its own messages dropped\n",
+                     d - dropped[i]);
+    else
+      len += sprintf(out + len, "+++ PP: %u turns of %c's narration dropped\n",
+                     d - dropped[i], 'A' + i);
+    dropped[i] = d;
+  }
+  write_all(out, len);
+}
+
+static void *writer_thread(void *arg) {
+  uint32_t next = 1; // entries are numbered from 1 in a new segment
+  uint32_t dropped[MAX_PLAYERS + 1];
+
+  trace_claim(TRACE_LOG);
+  for (int i = 0; i <= MAX_PLAYERS; i++)
+    dropped[i] = atomic_load(&n_state->logs[i].dropped);
+
+  while (1) {
+    int stopping = n_stopping;
+    uint32_t events =
+        atomic_load_explicit(&n_state->events, memory_order_acquire);
+    drain(&next, dropped);
+    if (stopping)
+      break;
+    futex_wait(&n_state->events, events, LOG_IDLE_MS);
+  }
+  return NULL;
+}
+
+int narrate_start() {
+  // every signal stays with the PP's own thread
+  sigset_t all, old;
+  sigfillset(&all);
+  pthread_sigmask(SIG_SETMASK, &all, &old);
+  int err = pthread_create(&n_writer, NULL, writer_thread, NULL);
+  pthread_sigmask(SIG_SETMASK, &old, NULL);
+  if (err != 0) {
+    fprintf(stderr, "pthread_create (narration): %s\n", strerror(err));
+    return -1;
+  }
+  n_running = 1;
+  return 0;
+}
+
+void narrate_stop() {
+  if (!n_running)
+    return;
+  n_stopping = 1;
+  futex_wake(&n_state->events);
+  pthread_join(n_writer, NULL);
+  n_running = 0;
+}
@@ -0,0 +1,33 @@
+/*
+ * narrate.h - Player narration through the shared log rings
+ * CS39002 Operating Systems Laboratory
+ *
+ * Author: Ashutosh Sharma
+ * Roll: 23CS10005
+ */
+
+#ifndef NARRATE_H
+#define NARRATE_H
+
+#include "state.h"
+
+#define NARRATE_PP MAX_PLAYERS // ring of the PP's own messages
+
+// a line is shown if its level is at most the narration level, which is
+// LOG_MOVES less ludo --quiet's
+#define LOG_EVENTS 1 // the PP, players starting and finishing
+#define LOG_MOVES 2  // every throw and move
+
+// level and full-ring policy from LUDO_QUIET and LUDO_NARRATION
+void narrate_init(struct ludo_state *state);
+// add to the entry being built for who (a player or NARRATE_PP)
+void narrate(int who, int level, const char *fmt, ...)
+    __attribute__((format(printf, 3, 4)));
+// push who's entry to its ring
+void narrate_flush(int who);
+// the thread that drains every ring to stdout, in the PP
+int narrate_start();
+// drain what is left and stop the thread
+void narrate_stop();
+
+#endif
@@ -0,0 +1,228 @@
+/*
+ * odds.c - Live win-probability estimates for the board process
+ * CS39002 Operating Systems Laboratory
+ *
+ * Threads of the BP play the game out from the position after the last
+ * published move on the headless engine, many times over, and count who
+ * finishes next and where everyone ends up. The estimate is anytime: it
+ * is published after every batch of rollouts, and a thread drops its
+ * counts and starts again as soon as another move is published.
+ *
+ * The threads run under SCHED_IDLE, so on a busy CPU they only get the
+ * time the game processes leave over, and they never take a lock the BP
+ * waits on: a rollout thread holds its slot's lock only to copy its
+ * counts in, and odds_read() skips a slot it finds locked.
+ *
+ * Author: Ashutosh Sharma
+ * Roll: 23CS10005
+ */
+
+#define _GNU_SOURCE // SCHED_IDLE
+
+#include "odds.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "futex.h"
+
+#define ODDS_BATCH 256          // rollouts between checks for a new move
+#define ODDS_MAX_GAMES 200000   // rollouts per position, over all threads
+
+// one rollout thread's counts for one position
+struct odds_slot {
+  pthread_mutex_t lock;
+  uint32_t events;
+  long games;
+  long first[MAX_PLAYERS];
+  long rank_sum[MAX_PLAYERS];
+} __attribute__((aligned(64)));
+
+static const int *o_board = NULL;
+static struct ludo_state *o_state = NULL;
+static int o_num_players = 0;
+static int o_threads = 0;
+static struct odds_slot *o_slots = NULL;
+static pthread_t *o_tids = NULL;
+static volatile int o_stopping = 0;
+
+static uint32_t load_acquire(_Atomic uint32_t *word) {
+  return atomic_load_explicit(word, memory_order_acquire);
+}
+
+// the position after the last published move into g; -1 while a turn is
+// under way, *rendered then being the turn to wait past
+static int snapshot(struct game *g, uint32_t *events, uint32_t *rendered) {
+  uint32_t turn = load_acquire(&o_state->turn);
+  *events = load_acquire(&o_state->events);
+  *rendered = load_acquire(&o_state->rendered);
+  if (*rendered != turn)
+    return -1; // the PP may have picked the next player already
+
+  game_init(g, o_num_players, 0);
+  g->current = o_state->current;
+  for (int i = 0; i < o_num_players; i++) {
+    g->pos[i] = o_state->players[i];
+    if (g->pos[i] == FINISH_CELL)
+      g->active--;
+  }
+
+  // a move published meanwhile would leave a mix of two positions
+  if (load_acquire(&o_state->events) != *events ||
+      load_acquire(&o_state->turn) != turn)
+    return -1;
+  return 0;
+}
+
+// play one game out from start
+static void rollout(const struct game *start, uint64_t *rng, long *first,
+                    long *rank_sum) {
+  struct game g = *start;
+  struct turn t;
+  int next = -1;
+
+  g.rng = rng_next(rng);
+  while (g.active > 1) {
+    game_turn(o_board, &g, &t);
+    if (t.rank == 0)
+      continue;
+    rank_sum[t.player] += t.rank;
+    if (next < 0) {
+      next = t.player;
+      first[next]++;
+    }
+  }
+  // the last one left takes the last place
+  for (int i = 0; i < g.num_players; i++)
+    if (g.pos[i] != FINISH_CELL)
+      rank_sum[i] += g.num_players;
+}
+
+static void publish(struct odds_slot *slot, uint32_t events, long games,
+                    const long *first, const long *rank_sum) {
+  pthread_mutex_lock(&slot->lock);
+  slot->events = events;
+  slot->games = games;
+  memcpy(slot->first, first, sizeof(slot->first));
+  memcpy(slot->rank_sum, rank_sum, sizeof(slot->rank_sum));
+  pthread_mutex_unlock(&slot->lock);
+}
+
+static void *odds_thread(void *arg) {
+  int id = (int)(long)arg;
+  struct odds_slot *slot = &o_slots[id];
+  long max_games = (ODDS_MAX_GAMES + o_threads - 1) / o_threads;
+  long first[MAX_PLAYERS], rank_sum[MAX_PLAYERS];
+  struct game start;
+
+  struct sched_param param = {0};
+  int err = pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+  if (err != 0)
+    fprintf(stderr, "pthread_setschedparam (SCHED_IDLE): %s\n",
+            strerror(err));
+
+  while (!o_stopping) {
+    uint32_t events, rendered;
+    if (snapshot(&start, &events, &rendered) < 0) {
+      futex_wait(&o_state->rendered, rendered, 100);
+      continue;
+    }
+
+    long games = 0;
+    memset(first, 0, sizeof(first));
+    memset(rank_sum, 0, sizeof(rank_sum));
+    publish(slot, events, 0, first, rank_sum);
+
+    // no game left to play out: the one still on the board is next to
+    // finish, behind everyone who already has
+    if (start.active == 1) {
+      for (int i = 0; i < start.num_players; i++) {
+        if (start.pos[i] != FINISH_CELL) {
+          first[i] = 1;
+          rank_sum[i] = start.num_players - start.active + 1;
+        }
+      }
+      publish(slot, events, 1, first, rank_sum);
+    }
+
+    // seeded by the position, so a redraw of it shows the same odds
+    uint64_t rng = rng_stream(events, id);
+    while (!o_stopping && start.active > 1 && games < max_games) {
+      for (int k = 0; k < ODDS_BATCH; k++)
+        rollout(&start, &rng, first, rank_sum);
+      games += ODDS_BATCH;
+      if (load_acquire(&o_state->events) != events)
+        break; // stale, start again from the new position
+      publish(slot, events, games, first, rank_sum);
+    }
+
+    // nothing more to learn about this position
+    while (!o_stopping && load_acquire(&o_state->events) == events)
+      futex_wait(&o_state->events, events, 100);
+  }
+  return NULL;
+}
+
+int odds_start(const int *board, struct ludo_state *state, int num_players,
+               int threads) {
+  o_board = board;
+  o_state = state;
+  o_num_players = num_players;
+  o_threads = threads;
+  o_slots = calloc(threads, sizeof(*o_slots));
+  o_tids = calloc(threads, sizeof(*o_tids));
+  if (o_slots == NULL || o_tids == NULL) {
+    perror("calloc");
+    return -1;
+  }
+
+  for (int i = 0; i < threads; i++) {
+    pthread_mutex_init(&o_slots[i].lock, NULL);
+    int err = pthread_create(&o_tids[i], NULL, odds_thread, (void *)(long)i);
+    if (err != 0) {
+      fprintf(stderr, "pthread_create: %s\n", strerror(err));
+      o_threads = i;
+      odds_stop();
+      return -1;
+    }
+  }
+  return 0;
+}
+
+int odds_read(struct odds *out) {
+  long first[MAX_PLAYERS] = {0}, rank_sum[MAX_PLAYERS] = {0};
+
+  memset(out, 0, sizeof(*out));
+  out->events = load_acquire(&o_state->events);
+  for (int i = 0; i < o_threads; i++) {
+    struct odds_slot *slot = &o_slots[i];
+    if (pthread_mutex_trylock(&slot->lock) != 0)
+      continue; // mid-publish; its batch shows up next time
+    if (slot->events == out->events && slot->games > 0) {
+      out->games += slot->games;
+      for (int p = 0; p < o_num_players; p++) {
+        first[p] += slot->first[p];
+        rank_sum[p] += slot->rank_sum[p];
+      }
+    }
+    pthread_mutex_unlock(&slot->lock);
+  }
+  if (out->games == 0)
+    return 0;
+
+  for (int p = 0; p < o_num_players; p++) {
+    out->first[p] = (double)first[p] / out->games;
+    out->rank[p] = (double)rank_sum[p] / out->games;
+  }
+  return 1;
+}
+
+void odds_stop() {
+  o_stopping = 1;
+  for (int i = 0; i < o_threads; i++)
+    pthread_join(o_tids[i], NULL);
+  o_threads = 0;
+}
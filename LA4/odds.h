@@ -0,0 +1,31 @@
+/*
+ * odds.h - Live win-probability estimates for the board process
+ * CS39002 Operating Systems Laboratory
+ *
+ * Author: Ashutosh Sharma
+ * Roll: 23CS10005
+ */
+
+#ifndef ODDS_H
+#define ODDS_H
+
+#include <stdint.h>
+
+#include "state.h"
+
+// rollouts so far from the position after the last published move
+struct odds {
+  uint32_t events; // state->events the rollouts started from
+  long games;
+  double first[MAX_PLAYERS]; // P(next player to finish)
+  double rank[MAX_PLAYERS];  // expected final rank
+};
+
+int odds_start(const int *board, struct ludo_state *state, int num_players,
+               int threads);
+// the estimate for the current position; 0 if there is none yet. Never
+// waits on the rollout threads.
+int odds_read(struct odds *out);
+void odds_stop();
+
+#endif
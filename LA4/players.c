@@ -3,7 +3,17 @@
  * CS39002 Operating Systems Laboratory
  *
  * PP manages player processes and coordinates turns via signals.
- * Each player process handles dice rolling and movement.
+ * Each player process handles dice rolling and movement, and reports the
+ * outcome as a move record on its own ring in the shared state.
+ * With LUDO_PLAYER_TASKS set (ludo --player-tasks) the players are
+ * coroutines (coro.h) resumed by the PP itself, one per turn.
+ *
+ * What the players print goes through a log ring each (narrate.h) to a
+ * writer thread in the PP, so a slow terminal never holds up a turn.
+ *
+ * For next N the CP raises batch_end instead of the turn counter and
+ * signals once; the PP then plays the turns back to back, starting each
+ * one when the previous record has been published.
  *
  * Author: Ashutosh Sharma
  * Roll: 23CS10005
@@ -14,26 +24,42 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/ipc.h>
-#include <sys/shm.h>
+#include <sys/mman.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <time.h>
 #include <unistd.h>
 
-#define BOARD_SIZE 101
-#define MAX_PLAYERS 26
+#include "affinity.h"
+#include "coro.h"
+#include "futex.h"
+#include "narrate.h"
+#include "shm.h"
+#include "state.h"
+#include "trace.h"
 
 // Global variables for PP
 int *shm_board = NULL;
 int *shm_players = NULL;
+struct ludo_state *shm_state = NULL;
+struct ludo_stats *stats = NULL;
+uint64_t turn_woke_ns = 0; // when this player was woken for its turn
+size_t board_bytes = 0;
+size_t players_bytes = 0;
 int num_players = 0;
 int pipe_fd = -1;
 pid_t bp_pid = -1;
 pid_t player_pids[MAX_PLAYERS];
-int current_player = -1;
 volatile sig_atomic_t move_requested = 0;
 volatile sig_atomic_t should_exit = 0;
+sigset_t pp_waiting; // signal mask while the PP waits for the CP
+int use_tasks = 0; // players as coroutines in the PP (LUDO_PLAYER_TASKS)
+
+// a player run as a coroutine: all it keeps between turns
+struct player_task {
+  struct coro co;
+  int idx;
+};
 
 // player symbols
 const char player_symbols[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
@@ -44,24 +70,56 @@ void pp_sigusr1_handler(int sig) { move_requested = 1; }
 void pp_sigusr2_handler(int sig) { should_exit = 1; }
 void player_sigusr1_handler(int sig) { player_move_signal = 1; }
 
+// wait for a turn request or SIGUSR2. Both are blocked outside this wait,
+// so one that arrives while the PP is finishing a batch is not lost.
+void pp_wait() {
+  trace(TRACE_PP, TRACE_WAIT, TRACE_BEGIN, atomic_load(&shm_state->turn));
+  while (!move_requested && !should_exit)
+    sigsuspend(&pp_waiting);
+  trace(TRACE_PP, TRACE_WAIT, TRACE_END, atomic_load(&shm_state->turn));
+}
+
+// report the outcome of a turn to every reader of this player's ring
+void publish_move(struct move_record *rec) {
+  trace(TRACE_PLAYER(rec->player), TRACE_COMMIT, TRACE_BEGIN, rec->turn);
+  narrate_flush(rec->player);
+  stat_add(&stats->turns, 1);
+  if (rec->result == TURN_CANCELLED)
+    stat_add(&stats->cancelled, 1);
+  else if (rec->result == TURN_OVERSHOOT)
+    stat_add(&stats->overshoot, 1);
+  else if (rec->result == TURN_BLOCKED)
+    stat_add(&stats->blocked, 1);
+  else if (rec->ndice > 0)
+    stat_add(&stats->chain_len[rec->hops < STAT_CHAIN_MAX
+                                   ? rec->hops
+                                   : STAT_CHAIN_MAX - 1],
+             1);
+  if (rec->rank)
+    stat_add(&stats->finished, 1);
+  stat_time(stats, STAGE_MOVE, stat_now_ns() - turn_woke_ns);
+
+  ring_push(&shm_state->rings[rec->player], rec);
+  atomic_fetch_add_explicit(&shm_state->events, 1, memory_order_release);
+  futex_wake(&shm_state->events);
+  trace(TRACE_PLAYER(rec->player), TRACE_COMMIT, TRACE_END, rec->turn);
+}
+
 // roll dice with 6s handling
 // returns: total dice value, or 0 if three 6s (cancelled)
-int roll_dice(int player_idx) {
+int roll_dice(int player_idx, struct move_record *rec) {
   int total = 0;
   int rolls = 0;
   int die;
   int all_sixes = 1;
 
-  printf("    %c throws: ", player_symbols[player_idx]);
-  fflush(stdout);
+  narrate(player_idx, LOG_MOVES, "    %c throws: ", player_symbols[player_idx]);
 
   while (rolls < 3) {
-    die = (rand() % 6) + 1;
+    die = rng_die(&shm_state->dice[player_idx]);
+    rec->dice[rec->ndice++] = die;
 
-    if (rolls > 0)
-      printf("+ ");
-    printf("%d ", die);
-    fflush(stdout);
+    narrate(player_idx, LOG_MOVES, rolls > 0 ? "+ %d " : "%d ", die);
 
     total += die;
     rolls++;
@@ -74,11 +132,12 @@ int roll_dice(int player_idx) {
 
   // three consecutive 6s cancel the move
   if (rolls == 3 && all_sixes) {
-    printf("= %d (X) Three 6's! Move cancelled.\n", total);
+    narrate(player_idx, LOG_MOVES, "= %d (X) Three 6's! Move cancelled.\n",
+            total);
     return 0;
   }
 
-  printf("= %d\n", total);
+  narrate(player_idx, LOG_MOVES, "= %d\n", total);
   return total;
 }
 
@@ -96,7 +155,7 @@ int is_cell_occupied(int cell, int current_player_idx) {
 }
 
 // apply snakes and ladders following chains
-int apply_snakes_ladders(int pos, int player_idx) {
+int apply_snakes_ladders(int pos, int player_idx, struct move_record *rec) {
   int visited[BOARD_SIZE] = {0}; // to prevent infinite loops
 
   while (pos > 0 && pos < 100 && shm_board[pos] != 0 && !visited[pos]) {
@@ -105,122 +164,318 @@ int apply_snakes_ladders(int pos, int player_idx) {
     int new_pos = pos + modifier;
 
     if (modifier > 0) {
-      printf("    %c climbs ladder: %d -> %d\n", player_symbols[player_idx],
-             pos, new_pos);
+      narrate(player_idx, LOG_MOVES, "    %c climbs ladder: %d -> %d\n",
+              player_symbols[player_idx], pos, new_pos);
     } else {
-      printf("    %c bitten by snake: %d -> %d\n", player_symbols[player_idx],
-             pos, new_pos);
+      narrate(player_idx, LOG_MOVES, "    %c bitten by snake: %d -> %d\n",
+              player_symbols[player_idx], pos, new_pos);
     }
 
     // check if new position is occupied
     if (is_cell_occupied(new_pos, player_idx)) {
-      printf("    But cell %d is occupied! Staying at %d\n", new_pos, pos);
+      narrate(player_idx, LOG_MOVES,
+              "    But cell %d is occupied! Staying at %d\n", new_pos, pos);
+      stat_add(&stats->chain_blocked, 1);
       break;
     }
 
     pos = new_pos;
+    rec->hops++;
+    stat_add(modifier > 0 ? &stats->ladders : &stats->snakes, 1);
   }
 
   return pos;
 }
 
+// one turn for a player: roll, move and publish the record
+// returns 1 once the player has reached 100
+int player_turn(int player_idx) {
+  turn_woke_ns = stat_now_ns();
+  uint64_t requested =
+      atomic_load_explicit(&stats->turn_start_ns, memory_order_relaxed);
+  if (requested && turn_woke_ns > requested)
+    stat_time(stats, STAGE_DISPATCH, turn_woke_ns - requested);
+
+  int current_pos = shm_players[player_idx];
+
+  struct move_record rec;
+  memset(&rec, 0, sizeof(rec));
+  rec.turn = atomic_load_explicit(&shm_state->turn, memory_order_acquire);
+  rec.player = player_idx;
+  rec.from = current_pos;
+  rec.to = current_pos;
+  rec.result = TURN_MOVED;
+
+  if (current_pos == 100) {
+    publish_move(&rec);
+    return 0;
+  }
+
+  narrate(player_idx, LOG_MOVES, "\n>>> %c's turn (at cell %d)\n",
+          player_symbols[player_idx], current_pos);
+
+  trace(TRACE_PLAYER(player_idx), TRACE_DICE, TRACE_BEGIN, rec.turn);
+  int dice = roll_dice(player_idx, &rec);
+  trace(TRACE_PLAYER(player_idx), TRACE_DICE, TRACE_END, rec.turn);
+
+  if (dice == 0) {
+    // move cancelled due to three 6s
+    rec.result = TURN_CANCELLED;
+    publish_move(&rec);
+    return 0;
+  }
+
+  int new_pos = current_pos + dice;
+
+  // check for exceeding 100
+  if (new_pos > 100) {
+    narrate(player_idx, LOG_MOVES, "    Move not allowed: %d + %d = %d > 100\n",
+            current_pos, dice, new_pos);
+    rec.result = TURN_OVERSHOOT;
+    publish_move(&rec);
+    return 0;
+  }
+
+  // check if target cell is occupied (before snakes/ladders)
+  if (new_pos < 100 && is_cell_occupied(new_pos, player_idx)) {
+    narrate(player_idx, LOG_MOVES,
+            "    Move not allowed: cell %d is occupied\n", new_pos);
+    rec.result = TURN_BLOCKED;
+    publish_move(&rec);
+    return 0;
+  }
+
+  // make the move
+  narrate(player_idx, LOG_MOVES, "    %c moves: %d -> %d\n",
+          player_symbols[player_idx], current_pos, new_pos);
+
+  // apply snakes and ladders (may chain)
+  if (new_pos < 100) {
+    new_pos = apply_snakes_ladders(new_pos, player_idx, &rec);
+  }
+
+  // update position
+  shm_players[player_idx] = new_pos;
+  rec.to = new_pos;
+
+  // check for win
+  if (new_pos == 100) {
+    int rank = num_players - shm_players[num_players] + 1;
+    narrate(player_idx, LOG_EVENTS,
+            "    *** %c reaches destination! Rank: %d ***\n",
+            player_symbols[player_idx], rank);
+    shm_players[num_players]--; // Decrement active count
+    rec.rank = rank;
+  }
+
+  publish_move(&rec);
+  return new_pos == 100;
+}
+
 // player process main function
 void player_process(int player_idx) {
-  srand(time(NULL) ^ (getpid() << 16) ^ (player_idx * 12345));
-
   signal(SIGUSR1, player_sigusr1_handler);
   signal(SIGUSR2, SIG_DFL);
 
-  printf("+++ Player %c started (PID %d)\n", player_symbols[player_idx],
-         getpid());
-  fflush(stdout);
+  // SIGUSR1 is only let in while waiting, so one sent just after a turn
+  // (next N plays them back to back) wakes the next wait instead of
+  // arriving before it and being lost
+  sigset_t usr1, waiting;
+  sigemptyset(&usr1);
+  sigaddset(&usr1, SIGUSR1);
+  sigemptyset(&waiting);
+  sigprocmask(SIG_SETMASK, &usr1, NULL);
 
-  while (1) {
-    pause();
+  sched_setup_from_env("PLAYERS");
+  trace_claim(TRACE_PLAYER(player_idx));
 
-    if (!player_move_signal)
-      continue;
-    player_move_signal = 0;
+  narrate(player_idx, LOG_EVENTS, "+++ Player %c started (PID %d)\n",
+          player_symbols[player_idx], getpid());
+  narrate_flush(player_idx);
 
-    int current_pos = shm_players[player_idx];
+  while (1) {
+    trace(TRACE_PLAYER(player_idx), TRACE_WAIT, TRACE_BEGIN,
+          atomic_load(&shm_state->turn));
+    while (!player_move_signal)
+      sigsuspend(&waiting);
+    player_move_signal = 0;
+    trace(TRACE_PLAYER(player_idx), TRACE_WAIT, TRACE_END,
+          atomic_load(&shm_state->turn));
 
-    if (current_pos == 100) {
-      kill(bp_pid, SIGUSR1);
-      continue;
+    if (player_turn(player_idx)) {
+      // Detach and exit
+      munmap(shm_board, board_bytes);
+      munmap(shm_state, players_bytes);
+      exit(0);
     }
+  }
+}
 
-    printf("\n>>> %c's turn (at cell %d)\n", player_symbols[player_idx],
-           current_pos);
-    fflush(stdout);
+// player task: the same loop as player_process(), with the wait for a
+// signal replaced by a yield back to the scheduler
+int player_task(struct player_task *task) {
+  CORO_BEGIN(&task->co);
+  narrate(task->idx, LOG_EVENTS, "+++ Player %c started (task)\n",
+          player_symbols[task->idx]);
+  narrate_flush(task->idx);
 
-    int dice = roll_dice(player_idx);
+  while (1) {
+    CORO_YIELD(&task->co);
+    if (player_turn(task->idx))
+      break;
+  }
+  CORO_END(&task->co);
+}
 
-    if (dice == 0) {
-      // move cancelled due to three 6s
-      kill(bp_pid, SIGUSR1);
-      continue;
-    }
+// players still in the game as a circular list in seat order, with a
+// head node at index num_players standing for "before player 0" (the
+// current pointer is -1 at the start). A finished player keeps its own
+// links, so the list can still be walked from it the turn after.
+int next_active[MAX_PLAYERS + 1];
+int prev_active[MAX_PLAYERS + 1];
 
-    int new_pos = current_pos + dice;
+void active_unlink(int p) {
+  next_active[prev_active[p]] = next_active[p];
+  prev_active[next_active[p]] = prev_active[p];
+}
 
-    // check for exceeding 100
-    if (new_pos > 100) {
-      printf("    Move not allowed: %d + %d = %d > 100\n", current_pos, dice,
-             new_pos);
-      kill(bp_pid, SIGUSR1);
-      continue;
+// link every seat, then drop those already at 100 (resumed games)
+void active_init() {
+  for (int i = 0; i <= num_players; i++) {
+    next_active[i] = i == num_players ? 0 : i + 1;
+    prev_active[i] = i == 0 ? num_players : i - 1;
+  }
+  for (int i = 0; i < num_players; i++)
+    if (shm_players[i] == 100)
+      active_unlink(i);
+}
+
+// get next active player in round-robin; the pointer lives in the shared
+// state so that a checkpoint carries it. Players only finish on their own
+// turn, so a finisher is unlinked here when the list next reaches it,
+// once, and each call is O(1) however many have finished.
+int get_next_player() {
+  int cur = shm_state->current < 0 ? num_players : shm_state->current;
+  int next = next_active[cur];
+
+  while (1) {
+    if (next == num_players) {
+      next = next_active[next];
+      if (next == num_players)
+        return -1; // no active players
     }
+    if (shm_players[next] != 100)
+      break;
+    active_unlink(next);
+    next = next_active[next];
+  }
+  shm_state->current = next;
+  return next;
+}
 
-    // check if target cell is occupied (before snakes/ladders)
-    if (new_pos < 100 && is_cell_occupied(new_pos, player_idx)) {
-      printf("    Move not allowed: cell %d is occupied\n", new_pos);
-      kill(bp_pid, SIGUSR1);
+// play the turns of a next N batch, up to batch_end or until everyone
+// has finished; with tasks == NULL the players are processes, and each
+// one's record is waited for before the next turn starts
+void play_batch(struct player_task *tasks) {
+  uint32_t end = atomic_load_explicit(&shm_state->batch_end,
+                                      memory_order_acquire);
+
+  while (!should_exit && shm_players[num_players] > 0 &&
+         atomic_load(&shm_state->turn) < end) {
+    int next = get_next_player();
+    if (next < 0)
+      break;
+
+    uint32_t turn = atomic_load(&shm_state->turn) + 1;
+    trace(TRACE_PP, TRACE_DISPATCH, TRACE_BEGIN, turn);
+    uint32_t seen = atomic_load_explicit(&shm_state->events,
+                                         memory_order_acquire);
+    atomic_store_explicit(&stats->turn_start_ns, stat_now_ns(),
+                          memory_order_relaxed);
+    atomic_fetch_add_explicit(&shm_state->turn, 1, memory_order_release);
+    if (tasks != NULL) {
+      trace(TRACE_PP, TRACE_DISPATCH, TRACE_END, turn);
+      player_task(&tasks[next]);
       continue;
     }
+    trace(TRACE_PP, TRACE_SIGNAL, TRACE_MARK, turn);
+    kill(player_pids[next], SIGUSR1);
+    trace(TRACE_PP, TRACE_DISPATCH, TRACE_END, turn);
+
+    trace(TRACE_PP, TRACE_RECORD_WAIT, TRACE_BEGIN, turn);
+    while (!should_exit && atomic_load_explicit(&shm_state->events,
+                                                memory_order_acquire) == seen)
+      futex_wait(&shm_state->events, seen, 100);
+    trace(TRACE_PP, TRACE_RECORD_WAIT, TRACE_END, turn);
+  }
+}
 
-    // make the move
-    printf("    %c moves: %d -> %d\n", player_symbols[player_idx], current_pos,
-           new_pos);
+// a turn request from the CP is for a batch when batch_end is ahead of
+// the turn counter (play_turn() raises the counter itself)
+int batch_requested() {
+  return atomic_load_explicit(&shm_state->batch_end, memory_order_acquire) >
+         atomic_load_explicit(&shm_state->turn, memory_order_acquire);
+}
 
-    // apply snakes and ladders (may chain)
-    if (new_pos < 100) {
-      new_pos = apply_snakes_ladders(new_pos, player_idx);
-    }
+// run every player as a task in this process and resume the next one
+// on each turn signal instead of forwarding the signal to it
+void player_task_scheduler() {
+  struct player_task *tasks = calloc(num_players, sizeof(*tasks));
+  if (tasks == NULL) {
+    perror("calloc (player tasks)");
+    exit(1);
+  }
 
-    // update position
-    shm_players[player_idx] = new_pos;
+  narrate(NARRATE_PP, LOG_EVENTS, "+++ PP: Creating %d player tasks...\n\n",
+          num_players);
+  narrate_flush(NARRATE_PP);
+  for (int i = 0; i < num_players; i++) {
+    tasks[i].idx = i;
+    trace_claim(TRACE_PLAYER(i));
+    player_task(&tasks[i]); // runs up to the first wait for a turn
+  }
 
-    // check for win
-    if (new_pos == 100) {
-      int rank = num_players - shm_players[num_players] + 1;
-      printf("    *** %c reaches destination! Rank: %d ***\n",
-             player_symbols[player_idx], rank);
-      shm_players[num_players]--; // Decrement active count
+  narrate(NARRATE_PP, LOG_EVENTS,
+          "+++ PP: All players ready\n"
+          "-----------------------------------------------------\n\n");
+  narrate_flush(NARRATE_PP);
 
-      // Signal BP and exit
-      kill(bp_pid, SIGUSR1);
+  while (!should_exit) {
+    pp_wait();
 
-      // Detach and exit
-      shmdt(shm_board);
-      shmdt(shm_players);
-      exit(0);
-    }
+    if (should_exit)
+      break;
 
-    // signal BP to redraw
-    kill(bp_pid, SIGUSR1);
-  }
-}
+    if (move_requested) {
+      move_requested = 0;
 
-// get next active player in round-robin
-int get_next_player() {
-  for (int i = 0; i < num_players; i++) {
-    current_player = (current_player + 1) % num_players;
-    // check if player is still active (not at 100)
-    if (shm_players[current_player] != 100) {
-      return current_player;
+      if (shm_players[num_players] <= 0)
+        continue;
+      if (batch_requested()) {
+        play_batch(tasks);
+        continue;
+      }
+
+      uint32_t turn = atomic_load(&shm_state->turn);
+      trace(TRACE_PP, TRACE_DISPATCH, TRACE_BEGIN, turn);
+      int next = get_next_player();
+      trace(TRACE_PP, TRACE_DISPATCH, TRACE_END, turn);
+      if (next < 0 || CORO_FINISHED(&tasks[next].co))
+        continue;
+
+      player_task(&tasks[next]);
     }
   }
-  return -1; // no active players
+
+  int running = 0;
+  for (int i = 0; i < num_players; i++)
+    running += !CORO_FINISHED(&tasks[i].co);
+  narrate(NARRATE_PP, LOG_EVENTS,
+          "\n+++ PP: Stopped %d player tasks (%d finished)\n"
+          "+++ PP: All players terminated. Exiting.\n",
+          running, num_players - running);
+  narrate_flush(NARRATE_PP);
+  free(tasks);
 }
 
 // player-parent main function
@@ -228,10 +483,27 @@ void player_parent_process() {
   signal(SIGUSR1, pp_sigusr1_handler);
   signal(SIGUSR2, pp_sigusr2_handler);
 
-  printf("+++ PP: Player-Parent started (PID %d)\n", getpid());
-  printf("+++ PP: Board process PID: %d\n", bp_pid);
-  printf("+++ PP: Creating %d player processes...\n\n", num_players);
-  fflush(stdout);
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGUSR1);
+  sigaddset(&signals, SIGUSR2);
+  sigprocmask(SIG_BLOCK, &signals, &pp_waiting);
+
+  narrate(NARRATE_PP, LOG_EVENTS,
+          "+++ PP: Player-Parent started (PID %d)\n"
+          "+++ PP: Board process PID: %d\n",
+          getpid(), bp_pid);
+  active_init();
+  if (use_tasks) {
+    if (narrate_start() < 0)
+      exit(1);
+    player_task_scheduler();
+    narrate_stop();
+    return;
+  }
+  narrate(NARRATE_PP, LOG_EVENTS,
+          "+++ PP: Creating %d player processes...\n\n", num_players);
+  narrate_flush(NARRATE_PP);
 
   for (int i = 0; i < num_players; i++) {
     player_pids[i] = fork();
@@ -248,16 +520,22 @@ void player_parent_process() {
     }
   }
 
+  // the writer starts after the forks, so no player inherits a copy of
+  // a process with a second thread
+  if (narrate_start() < 0)
+    exit(1);
+
   // give children a moment to print their startup messages
   sleep(1);
 
-  printf("+++ PP: All players ready\n");
-  printf("-----------------------------------------------------\n\n");
-  fflush(stdout);
+  narrate(NARRATE_PP, LOG_EVENTS,
+          "+++ PP: All players ready\n"
+          "-----------------------------------------------------\n\n");
+  narrate_flush(NARRATE_PP);
 
   // main loop
   while (!should_exit) {
-    pause();
+    pp_wait();
 
     if (should_exit)
       break;
@@ -269,19 +547,26 @@ void player_parent_process() {
       if (shm_players[num_players] <= 0) {
         continue;
       }
-
-      int next = get_next_player();
-      if (next < 0) {
+      if (batch_requested()) {
+        play_batch(NULL);
         continue;
       }
 
-      kill(player_pids[next], SIGUSR1);
+      uint32_t turn = atomic_load(&shm_state->turn);
+      trace(TRACE_PP, TRACE_DISPATCH, TRACE_BEGIN, turn);
+      int next = get_next_player();
+      if (next >= 0) {
+        trace(TRACE_PP, TRACE_SIGNAL, TRACE_MARK, turn);
+        kill(player_pids[next], SIGUSR1);
+      }
+      trace(TRACE_PP, TRACE_DISPATCH, TRACE_END, turn);
     }
   }
 
   // termination - send SIGUSR2 to all player processes
-  printf("\n+++ PP: Terminating player processes...\n");
-  fflush(stdout);
+  narrate(NARRATE_PP, LOG_EVENTS,
+          "\n+++ PP: Terminating player processes...\n");
+  narrate_flush(NARRATE_PP);
 
   for (int i = 0; i < num_players; i++) {
     if (player_pids[i] > 0) {
@@ -296,48 +581,61 @@ void player_parent_process() {
   for (int i = 0; i < num_players; i++) {
     if (player_pids[i] > 0) {
       waitpid(player_pids[i], NULL, 0);
-      printf("+++ PP: Player %c terminated\n", player_symbols[i]);
-      fflush(stdout);
+      narrate(NARRATE_PP, LOG_EVENTS, "+++ PP: Player %c terminated\n",
+              player_symbols[i]);
+      narrate_flush(NARRATE_PP);
       sleep(1); // Animation delay as per spec
     }
   }
 
-  printf("+++ PP: All players terminated. Exiting.\n");
-  fflush(stdout);
+  narrate(NARRATE_PP, LOG_EVENTS, "+++ PP: All players terminated. Exiting.\n");
+  narrate_flush(NARRATE_PP);
+  narrate_stop();
 }
 
 int main(int argc, char *argv[]) {
   if (argc < 6) {
     fprintf(stderr,
-            "Usage: %s <shm_board_id> <shm_players_id> <num_players> <pipe_fd> "
-            "<bp_pid>\n",
+            "Usage: %s <shm_board_path> <shm_players_path> <num_players> "
+            "<fifo> <bp_pid>\n",
             argv[0]);
     return 1;
   }
 
-  int shm_id_board = atoi(argv[1]);
-  int shm_id_players = atoi(argv[2]);
   num_players = atoi(argv[3]);
   const char *fifo_path = argv[4];
   bp_pid = atoi(argv[5]);
 
+  sched_setup_from_env("PP");
+  use_tasks = getenv("LUDO_PLAYER_TASKS") != NULL;
+
   pipe_fd = open(fifo_path, O_WRONLY);
   if (pipe_fd < 0) {
     perror("open fifo");
     return 1;
   }
 
-  shm_board = (int *)shmat(shm_id_board, NULL, SHM_RDONLY);
-  if (shm_board == (int *)-1) {
-    perror("shmat (board)");
+  // the board segment is sealed, so it can only be mapped read-only
+  int fd = shm_segment_open(argv[1], 0, &board_bytes);
+  if (fd < 0)
+    return 1;
+  shm_board = (int *)shm_segment_map(fd, board_bytes, 0);
+  close(fd);
+  if (shm_board == NULL)
     return 1;
-  }
 
-  shm_players = (int *)shmat(shm_id_players, NULL, 0);
-  if (shm_players == (int *)-1) {
-    perror("shmat (players)");
+  fd = shm_segment_open(argv[2], 1, &players_bytes);
+  if (fd < 0)
     return 1;
-  }
+  shm_state = (struct ludo_state *)shm_segment_map(fd, players_bytes, 1);
+  close(fd);
+  if (shm_state == NULL)
+    return 1;
+  shm_players = shm_state->players;
+  stats = &shm_state->stats;
+  narrate_init(shm_state);
+  trace_attach();
+  trace_claim(TRACE_PP);
 
   printf("\n");
   printf("------------------------------------------------------\n");
@@ -354,8 +652,8 @@ int main(int argc, char *argv[]) {
 
   player_parent_process();
 
-  shmdt(shm_board);
-  shmdt(shm_players);
+  munmap(shm_board, board_bytes);
+  munmap(shm_state, players_bytes);
 
   return 0;
 }
@@ -0,0 +1,219 @@
+/*
+ * replay.c - Replay verifier for move logs
+ * CS39002 Operating Systems Laboratory
+ *
+ * A --log file starts with "# seed <n> players <p>", and every player
+ * rolls from its own stream of that seed (rng.h). This is enough to play
+ * the game again on the headless engine: each engine turn is written in
+ * the log's own format and compared with the logged line, and the first
+ * line that differs is reported with both versions. A log the CP could
+ * not keep up with says so in a "# N records lost" line, and fails at
+ * that line instead of at the next move. Logs are checked by
+ * a pool of threads, one log at a time per thread.
+ *
+ * Author: Ashutosh Sharma
+ * Roll: 23CS10005
+ */
+
+#include "replay.h"
+#include "engine.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LINE_MAX_LEN 128
+
+struct replay_job {
+  const char *path;
+  long turns;
+  int ok;
+  long line;                   // first diverging line
+  char why[64];                // what went wrong
+  char logged[LINE_MAX_LEN];   // the line in the log
+  char replayed[LINE_MAX_LEN]; // what the engine did instead
+};
+
+static int r_board[BOARD_SIZE];
+static struct replay_job *r_jobs;
+static int r_njobs;
+static _Atomic int r_next;
+
+static const char *result_names[] = {"move", "cancel", "overshoot", "blocked"};
+
+// one turn as ludo.c's log_moves() writes it
+static int format_turn(char *buf, size_t len, uint64_t turn,
+                       const struct turn *t) {
+  int n = snprintf(buf, len, "%lu %c %d ", turn, 'A' + t->player, t->from);
+  for (int d = 0; d < t->ndice; d++)
+    n += snprintf(buf + n, len - n, "%s%d", d ? "," : "", t->dice[d]);
+  n += snprintf(buf + n, len - n, "%s %d %s %d %d", t->ndice ? "" : "-",
+                t->to, result_names[t->result], t->hops, t->rank);
+  return n;
+}
+
+static char *read_file(const char *path, size_t *size) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return NULL;
+  struct stat st;
+  if (fstat(fd, &st) < 0) {
+    close(fd);
+    return NULL;
+  }
+  char *data = malloc(st.st_size + 1);
+  size_t got = 0;
+  while (data != NULL && got < (size_t)st.st_size) {
+    ssize_t n = read(fd, data + got, st.st_size - got);
+    if (n <= 0)
+      break;
+    got += n;
+  }
+  close(fd);
+  if (data == NULL || got != (size_t)st.st_size) {
+    free(data);
+    return NULL;
+  }
+  data[got] = '\0';
+  *size = got;
+  return data;
+}
+
+static void fail(struct replay_job *job, long line, const char *why,
+                 const char *logged, size_t logged_len, const char *replayed) {
+  job->ok = 0;
+  job->line = line;
+  snprintf(job->why, sizeof(job->why), "%s", why);
+  if (logged_len >= sizeof(job->logged))
+    logged_len = sizeof(job->logged) - 1;
+  memcpy(job->logged, logged, logged_len);
+  job->logged[logged_len] = '\0';
+  snprintf(job->replayed, sizeof(job->replayed), "%s", replayed);
+}
+
+static void replay_one(struct replay_job *job) {
+  size_t size;
+  char *data = read_file(job->path, &size);
+  job->ok = 1;
+  if (data == NULL) {
+    fail(job, 0, "cannot read the log", "", 0, "");
+    return;
+  }
+
+  struct game g;
+  struct turn t;
+  char expect[LINE_MAX_LEN];
+  int started = 0;
+  long line = 0;
+  char *p = data, *end = data + size;
+
+  while (p < end) {
+    char *eol = memchr(p, '\n', end - p);
+    if (eol == NULL)
+      eol = end;
+    size_t len = eol - p;
+    line++;
+
+    if (len == 0 || p[0] == '#') {
+      unsigned long long seed, lost;
+      int players;
+      char player;
+      if (sscanf(p, "# %llu records lost for %c", &lost, &player) == 2) {
+        fail(job, line, "records lost, the log is incomplete", p, len, "");
+        break;
+      }
+      if (sscanf(p, "# seed %llu players %d", &seed, &players) == 2) {
+        if (players < 2 || players > MAX_PLAYERS) {
+          fail(job, line, "bad player count", p, len, "");
+          break;
+        }
+        game_init_streams(&g, players, seed);
+        started = 1;
+      }
+    } else if (!started) {
+      fail(job, line, "no '# seed' header before the first move", p, len, "");
+      break;
+    } else {
+      if (game_turn(r_board, &g, &t) < 0) {
+        fail(job, line, "game already over", p, len, "(no turn)");
+        break;
+      }
+      int n = format_turn(expect, sizeof(expect), g.turns, &t);
+      if ((size_t)n != len || memcmp(expect, p, len) != 0) {
+        fail(job, line, "move differs", p, len, expect);
+        break;
+      }
+      job->turns++;
+    }
+    p = eol + 1;
+  }
+  if (job->ok && !started)
+    fail(job, line, "no '# seed' header", "", 0, "");
+  free(data);
+}
+
+static void *replay_thread(void *arg) {
+  int i;
+  while ((i = atomic_fetch_add(&r_next, 1)) < r_njobs)
+    replay_one(&r_jobs[i]);
+  return NULL;
+}
+
+int replay_verify(const char *board_file, char **logs, int nlogs,
+                  int threads) {
+  if (board_load(r_board, board_file) < 0)
+    return nlogs;
+
+  r_jobs = calloc(nlogs, sizeof(*r_jobs));
+  if (r_jobs == NULL) {
+    perror("calloc");
+    return nlogs;
+  }
+  r_njobs = nlogs;
+  atomic_store(&r_next, 0);
+  for (int i = 0; i < nlogs; i++)
+    r_jobs[i].path = logs[i];
+
+  if (threads > nlogs)
+    threads = nlogs;
+  pthread_t tids[threads];
+  struct timespec start, stop;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (int i = 0; i < threads; i++)
+    pthread_create(&tids[i], NULL, replay_thread, NULL);
+  for (int i = 0; i < threads; i++)
+    pthread_join(tids[i], NULL);
+  clock_gettime(CLOCK_MONOTONIC, &stop);
+
+  int failed = 0;
+  long turns = 0;
+  for (int i = 0; i < nlogs; i++) {
+    struct replay_job *job = &r_jobs[i];
+    turns += job->turns;
+    if (job->ok) {
+      printf("+++ Verify: %s ok (%ld turns)\n", job->path, job->turns);
+      continue;
+    }
+    failed++;
+    printf("+++ Verify: %s:%ld: %s after %ld turns\n", job->path, job->line,
+           job->why, job->turns);
+    if (job->logged[0] || job->replayed[0]) {
+      printf("  - log:    %s\n", job->logged);
+      printf("  + engine: %s\n", job->replayed);
+    }
+  }
+
+  double secs = (stop.tv_sec - start.tv_sec) +
+                (stop.tv_nsec - start.tv_nsec) / 1e9;
+  printf("+++ Verify: %d logs, %ld turns in %.3f s (%.0f turns/s), %d "
+         "diverged\n",
+         nlogs, turns, secs, secs > 0 ? turns / secs : 0, failed);
+  free(r_jobs);
+  return failed;
+}
@@ -0,0 +1,16 @@
+/*
+ * replay.h - Replay verifier for move logs
+ * CS39002 Operating Systems Laboratory
+ *
+ * Author: Ashutosh Sharma
+ * Roll: 23CS10005
+ */
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+// replay every log on the headless engine, returns the number that diverge
+int replay_verify(const char *board_file, char **logs, int nlogs,
+                  int threads);
+
+#endif
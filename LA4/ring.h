@@ -0,0 +1,109 @@
+/*
+ * ring.h - Lock-free move record ring for Snake Ludo
+ * CS39002 Operating Systems Laboratory
+ *
+ * One ring per player lives in the shared state segment. The player is
+ * the only producer; any number of readers (CP, BP, loggers) follow it
+ * with their own cursor. Each slot carries the sequence number of the
+ * record in it, so a reader that falls more than RING_SIZE records
+ * behind notices and skips ahead instead of reading torn data.
+ *
+ * Author: Ashutosh Sharma
+ * Roll: 23CS10005
+ */
+
+#ifndef RING_H
+#define RING_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+
+#define RING_SIZE 256 // records per ring, power of two
+
+// one move, as reported by a player (16 bytes)
+struct move_record {
+  uint32_t turn; // turn id assigned by the CP
+  uint8_t player;
+  uint8_t result; // TURN_* from engine.h
+  uint8_t from;
+  uint8_t to;
+  uint8_t ndice;
+  uint8_t dice[3];
+  uint8_t hops; // snakes/ladders taken
+  uint8_t rank; // 0 unless the player finished this turn
+  uint8_t pad[2];
+};
+
+struct ring_slot {
+  _Atomic uint64_t seq; // index + 1 of the record in the slot, 0 = writing
+  _Atomic uint64_t word[2];
+};
+
+struct event_ring {
+  _Atomic uint64_t head; // records published so far
+  _Atomic uint64_t gate; // cursor of the reader the producer may wait for
+  char pad[48];
+  struct ring_slot slots[RING_SIZE];
+};
+
+struct ring_cursor {
+  uint64_t next;
+  uint64_t dropped;
+};
+
+// producer side: never blocks, overwrites the oldest record when full
+static inline void ring_push(struct event_ring *r,
+                             const struct move_record *rec) {
+  uint64_t pos = atomic_load_explicit(&r->head, memory_order_relaxed);
+  struct ring_slot *s = &r->slots[pos & (RING_SIZE - 1)];
+  uint64_t w[2];
+  memcpy(w, rec, sizeof(w));
+
+  atomic_store_explicit(&s->seq, 0, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  atomic_store_explicit(&s->word[0], w[0], memory_order_relaxed);
+  atomic_store_explicit(&s->word[1], w[1], memory_order_relaxed);
+  atomic_store_explicit(&s->seq, pos + 1, memory_order_release);
+  atomic_store_explicit(&r->head, pos + 1, memory_order_release);
+}
+
+// free slots before the gating reader would be overrun
+static inline int ring_space(struct event_ring *r) {
+  uint64_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+  uint64_t gate = atomic_load_explicit(&r->gate, memory_order_acquire);
+  return RING_SIZE - (int)(head - gate);
+}
+
+// reader side: returns 1 and fills rec, or 0 if nothing new
+static inline int ring_pop(struct event_ring *r, struct ring_cursor *c,
+                           struct move_record *rec) {
+  while (1) {
+    uint64_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+    if (c->next >= head)
+      return 0;
+    if (head - c->next > RING_SIZE) {
+      c->dropped += head - RING_SIZE - c->next;
+      c->next = head - RING_SIZE;
+    }
+
+    struct ring_slot *s = &r->slots[c->next & (RING_SIZE - 1)];
+    uint64_t seq = atomic_load_explicit(&s->seq, memory_order_acquire);
+    uint64_t w[2];
+    w[0] = atomic_load_explicit(&s->word[0], memory_order_relaxed);
+    w[1] = atomic_load_explicit(&s->word[1], memory_order_relaxed);
+    atomic_thread_fence(memory_order_acquire);
+
+    if (seq == c->next + 1 &&
+        atomic_load_explicit(&s->seq, memory_order_relaxed) == seq) {
+      memcpy(rec, w, sizeof(w));
+      c->next++;
+      return 1;
+    }
+    // overwritten while we were reading it, catch up and retry
+    c->dropped++;
+    c->next++;
+  }
+}
+
+#endif
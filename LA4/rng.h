@@ -0,0 +1,37 @@
+/*
+ * rng.h - Addressable dice streams for Snake Ludo
+ * CS39002 Operating Systems Laboratory
+ *
+ * splitmix64 keeps one 64-bit word of state, so a stream is just its
+ * starting word. rng_stream(seed, id) names stream id of a seed: the game
+ * processes use one per player and the simulators one per game, so the
+ * same seed replays the same dice no matter which process, thread or
+ * lane ends up rolling them.
+ *
+ * Author: Ashutosh Sharma
+ * Roll: 23CS10005
+ */
+
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+static inline uint64_t rng_next(uint64_t *state) {
+  uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+static inline int rng_die(uint64_t *state) {
+  return (int)(((rng_next(state) >> 32) * 6) >> 32) + 1;
+}
+
+// first state of stream id; hashed so nearby ids do not overlap
+static inline uint64_t rng_stream(uint64_t seed, uint64_t id) {
+  uint64_t s = seed ^ (id * 0xd1342543de82ef95ULL);
+  return rng_next(&s);
+}
+
+#endif
@@ -0,0 +1,439 @@
+/*
+ * search.c - Board layout search for Snake Ludo
+ * CS39002 Operating Systems Laboratory
+ *
+ * Starts from a ludo.txt board and moves, stretches and flips its snakes
+ * and ladders with simulated annealing. Every candidate is scored by
+ * playing games on it with the batched simulator from batch.c against
+ * target mean length, spread and seat fairness. Scores are cached by
+ * board hash, so a layout the search walks back into is not replayed.
+ * The best boards are written in the same L/S/E format as ludo.txt.
+ *
+ * Author: Ashutosh Sharma
+ * Roll: 23CS10005
+ */
+
+#include "batch.h"
+#include "engine.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_LINKS 64
+#define CACHE_SIZE (1 << 16) // evaluations remembered, power of two
+#define MAX_KEEP 16
+
+struct link {
+  int from;
+  int to;
+};
+
+struct layout {
+  int nlinks;
+  struct link links[MAX_LINKS];
+};
+
+// what a board scored
+struct score {
+  uint64_t hash;
+  double cost;
+  double mean;
+  double sd;
+  double spread; // best seat's first-finish share minus the worst's
+};
+
+struct cache_entry {
+  uint64_t hash; // 0 = empty
+  struct score score;
+};
+
+struct kept {
+  struct layout layout;
+  struct score score;
+};
+
+// search settings
+static int num_players;
+static long games = 20000;
+static int threads;
+static uint64_t sim_seed = 1;
+static double target_mean;
+static double target_sd;      // 0 = not scored
+static double fair_weight = 1.0;
+
+static struct cache_entry *cache;
+static long cache_hits;
+static long evaluations;
+
+static struct kept best[MAX_KEEP];
+static int num_best;
+static int keep = 3;
+
+static uint64_t search_rng;
+
+static int rand_int(int lo, int hi) { // inclusive
+  return lo + (int)(rng_next(&search_rng) % (uint64_t)(hi - lo + 1));
+}
+
+static double rand_unit() {
+  return (rng_next(&search_rng) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static void layout_to_board(const struct layout *lay, int *board) {
+  memset(board, 0, BOARD_SIZE * sizeof(int));
+  for (int i = 0; i < lay->nlinks; i++)
+    board[lay->links[i].from] = lay->links[i].to - lay->links[i].from;
+}
+
+static int layout_load(struct layout *lay, const char *filename) {
+  int board[BOARD_SIZE];
+  if (board_load(board, filename) < 0)
+    return -1;
+  lay->nlinks = 0;
+  for (int cell = 1; cell < FINISH_CELL; cell++) {
+    if (board[cell] == 0)
+      continue;
+    if (lay->nlinks == MAX_LINKS) {
+      fprintf(stderr, "Error: more than %d snakes and ladders\n", MAX_LINKS);
+      return -1;
+    }
+    lay->links[lay->nlinks].from = cell;
+    lay->links[lay->nlinks].to = cell + board[cell];
+    lay->nlinks++;
+  }
+  return 0;
+}
+
+// written sorted by start cell, like the hand-made boards
+static int layout_write(const struct layout *lay, const char *filename) {
+  int board[BOARD_SIZE];
+  layout_to_board(lay, board);
+
+  FILE *fp = fopen(filename, "w");
+  if (fp == NULL) {
+    perror("fopen (output)");
+    return -1;
+  }
+  for (int cell = 1; cell < FINISH_CELL; cell++) {
+    if (board[cell] != 0)
+      fprintf(fp, "%c %d %d\n", board[cell] > 0 ? 'L' : 'S', cell,
+              cell + board[cell]);
+  }
+  fprintf(fp, "E\n");
+  return fclose(fp);
+}
+
+// FNV-1a over the per-cell modifiers, so link order does not matter
+static uint64_t layout_hash(const struct layout *lay) {
+  int board[BOARD_SIZE];
+  layout_to_board(lay, board);
+  uint64_t h = 0xcbf29ce484222325ULL;
+  for (int cell = 0; cell < BOARD_SIZE; cell++) {
+    h ^= (uint32_t)board[cell];
+    h *= 0x100000001b3ULL;
+  }
+  return h ? h : 1;
+}
+
+static int link_valid(const struct layout *lay, int skip, struct link l) {
+  if (l.from < 2 || l.from >= FINISH_CELL || l.to < 1 || l.to > FINISH_CELL ||
+      l.from == l.to)
+    return 0;
+  for (int i = 0; i < lay->nlinks; i++) {
+    if (i != skip && lay->links[i].from == l.from)
+      return 0;
+  }
+  return 1;
+}
+
+// one random change to one snake or ladder
+static void layout_mutate(struct layout *lay) {
+  for (;;) {
+    int i = rand_int(0, lay->nlinks - 1);
+    struct link l = lay->links[i];
+
+    switch (rand_int(0, 3)) {
+    case 0: // slide the whole link
+    {
+      int shift = rand_int(-8, 8);
+      l.from += shift;
+      l.to += shift;
+      break;
+    }
+    case 1: // move the head
+      l.from += rand_int(-5, 5);
+      break;
+    case 2: // move the tail
+      l.to += rand_int(-10, 10);
+      break;
+    case 3: // ladder becomes a snake and back
+    {
+      int t = l.from;
+      l.from = l.to;
+      l.to = t;
+      break;
+    }
+    }
+    if (link_valid(lay, i, l)) {
+      lay->links[i] = l;
+      return;
+    }
+  }
+}
+
+static struct cache_entry *cache_slot(uint64_t hash) {
+  size_t i = hash & (CACHE_SIZE - 1);
+  while (cache[i].hash != 0 && cache[i].hash != hash)
+    i = (i + 1) & (CACHE_SIZE - 1);
+  return &cache[i];
+}
+
+// score a layout: squared relative misses on the targets plus unfairness;
+// returns -1 if the games could not all be played
+static int evaluate(const struct layout *lay, struct score *out) {
+  uint64_t hash = layout_hash(lay);
+  struct cache_entry *slot = cache_slot(hash);
+  if (slot->hash == hash) {
+    cache_hits++;
+    *out = slot->score;
+    return 0;
+  }
+
+  int board[BOARD_SIZE];
+  struct sim_result res;
+  // same streams for every board: candidates see the same dice
+  struct sim_range range = {sim_seed, 0, games, 0};
+  layout_to_board(lay, board);
+  memset(&res, 0, sizeof(res));
+  if (batch_simulate(board, num_players, &range, threads, 1024, NULL, &res) <
+      0)
+    return -1;
+  evaluations++;
+
+  struct score s;
+  double n = res.games;
+  s.hash = hash;
+  s.mean = res.turns / n;
+  s.sd = sqrt(res.len_sq / n - s.mean * s.mean);
+  uint64_t lo = res.wins[0], hi = res.wins[0];
+  for (int p = 1; p < num_players; p++) {
+    if (res.wins[p] < lo)
+      lo = res.wins[p];
+    if (res.wins[p] > hi)
+      hi = res.wins[p];
+  }
+  s.spread = (hi - lo) / n;
+
+  double miss = (s.mean - target_mean) / target_mean;
+  s.cost = miss * miss + fair_weight * s.spread * s.spread;
+  if (target_sd > 0) {
+    double sd_miss = (s.sd - target_sd) / target_sd;
+    s.cost += sd_miss * sd_miss;
+  }
+
+  // a full cache just stops remembering
+  if (evaluations < CACHE_SIZE / 2) {
+    slot->hash = hash;
+    slot->score = s;
+  }
+  *out = s;
+  return 0;
+}
+
+// keep the best distinct boards seen, cheapest first
+static void remember(const struct layout *lay, struct score s) {
+  for (int i = 0; i < num_best; i++) {
+    if (best[i].score.hash == s.hash)
+      return;
+  }
+  if (num_best == keep && s.cost >= best[num_best - 1].score.cost)
+    return;
+
+  int i = num_best < keep ? num_best++ : num_best - 1;
+  while (i > 0 && best[i - 1].score.cost > s.cost) {
+    best[i] = best[i - 1];
+    i--;
+  }
+  best[i].layout = *lay;
+  best[i].score = s;
+}
+
+static void print_score(const char *what, struct score s) {
+  printf("%-8s cost %.6f  mean %.2f  sd %.2f  seat spread %.2f%%\n", what,
+         s.cost, s.mean, s.sd, 100.0 * s.spread);
+}
+
+// the simulator could not play a board's games; its score would be
+// made up, so the search ends here
+static int evaluation_failed() {
+  fprintf(stderr, "Error: a board could not be evaluated, search stopped\n");
+  free(cache);
+  return 1;
+}
+
+void print_usage(char *prog_name) {
+  printf("Usage: %s [-b board] [-o prefix] [-n iterations] [-g games]"
+         "\n          [-L mean] [-S sd] [-f weight] [-T temp] [-k keep]"
+         "\n          [-t threads] [-s seed] <num_players>\n",
+         prog_name);
+  printf("  -b board       starting board (default: ludo.txt)\n");
+  printf("  -o prefix      write the best boards to prefix-1.txt, ... "
+         "(default: search)\n");
+  printf("  -n iterations  annealing steps (default: 2000)\n");
+  printf("  -g games       games per evaluation (default: 20000)\n");
+  printf("  -L mean        target turns per game (default: the start "
+         "board's)\n");
+  printf("  -S sd          target standard deviation (default: not scored)\n");
+  printf("  -f weight      weight of seat unfairness (default: 1)\n");
+  printf("  -T temp        starting temperature (default: 0.01)\n");
+  printf("  -k keep        boards to write, up to %d (default: 3)\n",
+         MAX_KEEP);
+  printf("  -t threads     simulator threads (default: online CPUs)\n");
+  printf("  -s seed        search seed (default: time)\n");
+}
+
+int main(int argc, char *argv[]) {
+  const char *board_file = "ludo.txt";
+  const char *prefix = "search";
+  long iterations = 2000;
+  double temp0 = 0.01;
+  uint64_t seed = time(NULL);
+  int opt;
+
+  threads = sysconf(_SC_NPROCESSORS_ONLN);
+  while ((opt = getopt(argc, argv, "b:o:n:g:L:S:f:T:k:t:s:h")) != -1) {
+    switch (opt) {
+    case 'b':
+      board_file = optarg;
+      break;
+    case 'o':
+      prefix = optarg;
+      break;
+    case 'n':
+      iterations = atol(optarg);
+      break;
+    case 'g':
+      games = atol(optarg);
+      break;
+    case 'L':
+      target_mean = atof(optarg);
+      break;
+    case 'S':
+      target_sd = atof(optarg);
+      break;
+    case 'f':
+      fair_weight = atof(optarg);
+      break;
+    case 'T':
+      temp0 = atof(optarg);
+      break;
+    case 'k':
+      keep = atoi(optarg);
+      break;
+    case 't':
+      threads = atoi(optarg);
+      break;
+    case 's':
+      seed = strtoull(optarg, NULL, 0);
+      break;
+    default:
+      print_usage(argv[0]);
+      return opt == 'h' ? 0 : 1;
+    }
+  }
+  if (optind >= argc) {
+    print_usage(argv[0]);
+    return 1;
+  }
+  num_players = atoi(argv[optind]);
+  if (num_players < 2 || num_players > MAX_PLAYERS) {
+    fprintf(stderr, "Error: Number of players must be between 2 and %d\n",
+            MAX_PLAYERS);
+    return 1;
+  }
+  if (games < 1 || threads < 1 || iterations < 0 || keep < 1 ||
+      keep > MAX_KEEP || temp0 <= 0) {
+    fprintf(stderr, "Error: invalid search settings\n");
+    return 1;
+  }
+
+  struct layout cur;
+  if (layout_load(&cur, board_file) < 0)
+    return 1;
+  if (cur.nlinks == 0) {
+    fprintf(stderr, "Error: %s has no snakes or ladders to move\n",
+            board_file);
+    return 1;
+  }
+
+  cache = calloc(CACHE_SIZE, sizeof(*cache));
+  if (cache == NULL) {
+    perror("calloc");
+    return 1;
+  }
+  search_rng = seed;
+  sim_seed = seed;
+
+  // score the start board against itself if no target length was given
+  double given_mean = target_mean;
+  if (given_mean <= 0)
+    target_mean = 1;
+  struct score cur_score;
+  if (evaluate(&cur, &cur_score) < 0)
+    return evaluation_failed();
+  if (given_mean <= 0) {
+    target_mean = cur_score.mean;
+    memset(cache, 0, CACHE_SIZE * sizeof(*cache));
+    evaluations = 0;
+    if (evaluate(&cur, &cur_score) < 0)
+      return evaluation_failed();
+  }
+  printf("+++ Search: %d players, %d links, %ld games per board, target "
+         "mean %.2f\n",
+         num_players, cur.nlinks, games, target_mean);
+  print_score("start", cur_score);
+  remember(&cur, cur_score);
+
+  double start = time(NULL);
+  for (long it = 0; it < iterations; it++) {
+    // geometric cooling down to 1/1000 of the start temperature
+    double temp = temp0 * pow(1e-3, (double)it / iterations);
+
+    struct layout cand = cur;
+    layout_mutate(&cand);
+    struct score s;
+    if (evaluate(&cand, &s) < 0)
+      return evaluation_failed();
+    remember(&cand, s);
+
+    double delta = s.cost - cur_score.cost;
+    if (delta <= 0 || rand_unit() < exp(-delta / temp)) {
+      cur = cand;
+      cur_score = s;
+    }
+
+    if ((it + 1) % 100 == 0) {
+      printf("+++ Search: step %ld, T %.2e, current %.6f, best %.6f "
+             "(%ld evaluated, %ld cached)\n",
+             it + 1, temp, cur_score.cost, best[0].score.cost, evaluations,
+             cache_hits);
+      fflush(stdout);
+    }
+  }
+
+  printf("+++ Search: %ld boards evaluated, %ld cache hits in %.0f s\n",
+         evaluations, cache_hits, time(NULL) - start);
+  for (int i = 0; i < num_best; i++) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s-%d.txt", prefix, i + 1);
+    if (layout_write(&best[i].layout, path) < 0)
+      return 1;
+    print_score(path, best[i].score);
+  }
+  free(cache);
+  return 0;
+}
@@ -0,0 +1,616 @@
+/*
+ * server.c - Multi-game server for Snake Ludo
+ * CS39002 Operating Systems Laboratory
+ *
+ * Hosts many independent headless games in one process. All games share
+ * one read-only board image; per-game state lives in slabs of fixed-size
+ * slots carved from one arena, optionally backed by 2MB hugepages. Games
+ * with pending turns are queued to a pool of worker threads, and the
+ * whole thing is driven through a line protocol on a Unix socket.
+ *
+ * Author: Ashutosh Sharma
+ * Roll: 23CS10005
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "engine.h"
+#include "shm.h"
+
+#define DEFAULT_SOCKET "/tmp/ludo_server.sock"
+#define SLAB_GAMES 1024 // slots per slab
+#define DEFAULT_MAX_GAMES 65536
+#define QUANTUM 256     // turns a worker plays before requeueing a game
+#define RUN_FOREVER -1
+
+// one game slot in a slab
+struct slot {
+  pthread_mutex_t lock;
+  struct game g;
+  int in_use;
+  int queued;
+  long pending; // turns still to play, RUN_FOREVER = until finished
+  int next;     // free list / run queue link
+};
+
+// shared read-only board
+int *board = NULL;
+
+// arena of game slots, handed out a slab at a time
+struct slot *arena = NULL;
+int max_games = DEFAULT_MAX_GAMES;
+int use_hugepages = 0;
+_Atomic int num_slabs = 0; // written under slab_lock, read by get_slot()
+int free_head = -1;
+_Atomic int games_live = 0; // written under slab_lock, read by stats
+pthread_mutex_t slab_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// run queue of game ids, linked through slot.next
+int queue_head = -1, queue_tail = -1;
+int queue_len = 0;   // games waiting in the queue
+int outstanding = 0; // games queued or being played
+int stopping = 0;
+pthread_mutex_t queue_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t queue_cond = PTHREAD_COND_INITIALIZER;
+pthread_cond_t idle_cond = PTHREAD_COND_INITIALIZER;
+
+atomic_ulong total_turns;
+atomic_ulong games_finished;
+
+const char *socket_path = DEFAULT_SOCKET;
+int listen_fd = -1;
+int num_threads = 4;
+volatile sig_atomic_t should_exit = 0;
+
+void sigint_handler(int sig) { should_exit = 1; }
+
+// a slab's slots are set up before num_slabs counts it, so a client that
+// sees the count can use them without taking slab_lock
+struct slot *get_slot(int id) {
+  int slabs = atomic_load_explicit(&num_slabs, memory_order_acquire);
+  if (id < 0 || id >= slabs * SLAB_GAMES)
+    return NULL;
+  return &arena[id];
+}
+
+// load the board once and make it read-only for every game
+int load_shared_board(const char *filename) {
+  board = mmap(NULL, BOARD_SIZE * sizeof(int), PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (board == MAP_FAILED) {
+    perror("mmap (board)");
+    return -1;
+  }
+
+  if (board_load(board, filename) < 0)
+    return -1;
+
+  if (mprotect(board, BOARD_SIZE * sizeof(int), PROT_READ) < 0) {
+    perror("mprotect (board)");
+    return -1;
+  }
+  return 0;
+}
+
+// reserve the slot arena; pages are only touched as slabs are handed out
+int create_arena() {
+  size_t bytes = (size_t)max_games * sizeof(struct slot);
+  int fd = shm_segment_create("ludo-arena", bytes,
+                              use_hugepages ? SHM_HUGE : 0);
+  if (fd < 0)
+    return -1;
+
+  arena = (struct slot *)shm_segment_map(fd, bytes, 1);
+  close(fd);
+  if (arena == NULL)
+    return -1;
+  return 0;
+}
+
+// add a slab of free slots (slab_lock held)
+int grow_slabs() {
+  int base = num_slabs * SLAB_GAMES;
+  if (base + SLAB_GAMES > max_games)
+    return -1;
+
+  struct slot *slab = &arena[base];
+  for (int i = SLAB_GAMES - 1; i >= 0; i--) {
+    pthread_mutex_init(&slab[i].lock, NULL);
+    slab[i].next = free_head;
+    free_head = base + i;
+  }
+  atomic_store_explicit(&num_slabs, num_slabs + 1, memory_order_release);
+  return 0;
+}
+
+int alloc_game(int num_players, uint64_t seed) {
+  pthread_mutex_lock(&slab_lock);
+  if (free_head < 0 && grow_slabs() < 0) {
+    pthread_mutex_unlock(&slab_lock);
+    return -1;
+  }
+  int id = free_head;
+  struct slot *s = get_slot(id);
+  free_head = s->next;
+  games_live++;
+  pthread_mutex_unlock(&slab_lock);
+
+  pthread_mutex_lock(&s->lock);
+  game_init(&s->g, num_players, seed);
+  s->in_use = 1;
+  s->queued = 0;
+  s->pending = 0;
+  pthread_mutex_unlock(&s->lock);
+  return id;
+}
+
+// release an idle game, returns -1 if it is unknown or still queued
+int free_game(int id) {
+  struct slot *s = get_slot(id);
+  if (s == NULL)
+    return -1;
+
+  pthread_mutex_lock(&s->lock);
+  if (!s->in_use || s->queued) {
+    pthread_mutex_unlock(&s->lock);
+    return -1;
+  }
+  s->in_use = 0;
+  pthread_mutex_unlock(&s->lock);
+
+  pthread_mutex_lock(&slab_lock);
+  s->next = free_head;
+  free_head = id;
+  games_live--;
+  pthread_mutex_unlock(&slab_lock);
+  return 0;
+}
+
+// append a game to the run queue (caller holds the slot lock)
+void enqueue_game(int id, int is_new) {
+  pthread_mutex_lock(&queue_lock);
+  get_slot(id)->next = -1;
+  if (queue_tail >= 0)
+    get_slot(queue_tail)->next = id;
+  else
+    queue_head = id;
+  queue_tail = id;
+  queue_len++;
+  if (is_new)
+    outstanding++;
+  pthread_cond_signal(&queue_cond);
+  pthread_mutex_unlock(&queue_lock);
+}
+
+// give a game more turns and queue it if it is not already; returns -1
+// if there is no such game, -2 if it is over and can take no more
+int schedule_game(int id, long turns) {
+  struct slot *s = get_slot(id);
+  if (s == NULL)
+    return -1;
+
+  pthread_mutex_lock(&s->lock);
+  if (!s->in_use) {
+    pthread_mutex_unlock(&s->lock);
+    return -1;
+  }
+  if (s->g.active == 0) {
+    pthread_mutex_unlock(&s->lock);
+    return -2;
+  }
+  if (turns == RUN_FOREVER || s->pending == RUN_FOREVER)
+    s->pending = RUN_FOREVER;
+  else
+    s->pending += turns;
+
+  if (!s->queued) {
+    s->queued = 1;
+    enqueue_game(id, 1);
+  }
+  pthread_mutex_unlock(&s->lock);
+  return 0;
+}
+
+void *worker_thread(void *arg) {
+  struct turn t;
+
+  while (1) {
+    pthread_mutex_lock(&queue_lock);
+    while (queue_head < 0 && !stopping)
+      pthread_cond_wait(&queue_cond, &queue_lock);
+    if (stopping) {
+      pthread_mutex_unlock(&queue_lock);
+      break;
+    }
+    int id = queue_head;
+    struct slot *s = get_slot(id);
+    queue_head = s->next;
+    if (queue_head < 0)
+      queue_tail = -1;
+    queue_len--;
+    pthread_mutex_unlock(&queue_lock);
+
+    pthread_mutex_lock(&s->lock);
+    int played = 0;
+    while (played < QUANTUM && s->pending != 0 && s->g.active > 0) {
+      game_turn(board, &s->g, &t);
+      played++;
+      if (s->pending > 0)
+        s->pending--;
+    }
+    atomic_fetch_add_explicit(&total_turns, played, memory_order_relaxed);
+
+    int requeue = s->pending != 0 && s->g.active > 0;
+    if (!requeue) {
+      if (s->g.active == 0)
+        atomic_fetch_add_explicit(&games_finished, 1, memory_order_relaxed);
+      s->queued = 0;
+      s->pending = 0;
+    } else {
+      enqueue_game(id, 0);
+    }
+    pthread_mutex_unlock(&s->lock);
+
+    if (!requeue) {
+      pthread_mutex_lock(&queue_lock);
+      if (--outstanding == 0)
+        pthread_cond_broadcast(&idle_cond);
+      pthread_mutex_unlock(&queue_lock);
+    }
+  }
+  return NULL;
+}
+
+// write a formatted reply line to a client
+void reply(int fd, const char *fmt, ...) {
+  char buffer[1024];
+  va_list ap;
+  va_start(ap, fmt);
+  int n = vsnprintf(buffer, sizeof(buffer) - 1, fmt, ap);
+  va_end(ap);
+  if (n > (int)sizeof(buffer) - 2)
+    n = sizeof(buffer) - 2;
+  buffer[n++] = '\n';
+
+  int off = 0;
+  while (off < n) {
+    int w = write(fd, buffer + off, n - off);
+    if (w < 0 && errno == EINTR)
+      continue;
+    if (w <= 0)
+      return;
+    off += w;
+  }
+}
+
+uint64_t make_seed() {
+  static atomic_ulong counter;
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ((uint64_t)ts.tv_sec << 32) ^ ts.tv_nsec ^ ((uint64_t)getpid() << 40) ^
+         (atomic_fetch_add(&counter, 1) * 0x9e3779b97f4a7c15ULL);
+}
+
+void reply_state(int fd, int id) {
+  struct slot *s = get_slot(id);
+  if (s == NULL) {
+    reply(fd, "ERR no such game");
+    return;
+  }
+
+  char buffer[512];
+  int off = 0;
+  pthread_mutex_lock(&s->lock);
+  if (!s->in_use) {
+    pthread_mutex_unlock(&s->lock);
+    reply(fd, "ERR no such game");
+    return;
+  }
+  for (int i = 0; i < s->g.num_players; i++)
+    off += snprintf(buffer + off, sizeof(buffer) - off, "%s%d", i ? "," : "",
+                    s->g.pos[i]);
+  reply(fd, "OK turns=%llu active=%d/%d last=%c queued=%d pos=%s",
+        (unsigned long long)s->g.turns, s->g.active, s->g.num_players,
+        s->g.current < 0 ? '-' : 'A' + s->g.current, s->queued, buffer);
+  pthread_mutex_unlock(&s->lock);
+}
+
+// apply fn to every live game, returns how many succeeded
+int for_all_games(int (*fn)(int, long), long arg) {
+  pthread_mutex_lock(&slab_lock);
+  int total = num_slabs * SLAB_GAMES;
+  pthread_mutex_unlock(&slab_lock);
+
+  int done = 0;
+  for (int id = 0; id < total; id++) {
+    if (fn(id, arg) == 0)
+      done++;
+  }
+  return done;
+}
+
+int drop_game(int id, long unused) { return free_game(id); }
+
+// handle one command line, returns 1 if the client should be closed
+int handle_command(int fd, char *line) {
+  char cmd[32] = "";
+  char arg1[32] = "";
+  long a = 0, b = 0;
+  int n = sscanf(line, "%31s %31s %ld", cmd, arg1, &b);
+  if (n < 1)
+    return 0;
+  a = atol(arg1);
+
+  if (strcmp(cmd, "new") == 0) {
+    if (n < 2 || a < 2 || a > MAX_PLAYERS) {
+      reply(fd, "ERR usage: new <players 2-%d> [seed]", MAX_PLAYERS);
+      return 0;
+    }
+    int id = alloc_game(a, n >= 3 ? (uint64_t)b : make_seed());
+    if (id < 0) {
+      reply(fd, "ERR out of game slots");
+      return 0;
+    }
+    reply(fd, "OK %d", id);
+  } else if (strcmp(cmd, "spawn") == 0) {
+    if (n < 3 || a < 1 || b < 2 || b > MAX_PLAYERS) {
+      reply(fd, "ERR usage: spawn <count> <players 2-%d>", MAX_PLAYERS);
+      return 0;
+    }
+    int first = -1, made = 0;
+    for (long i = 0; i < a; i++) {
+      int id = alloc_game(b, make_seed());
+      if (id < 0)
+        break;
+      if (first < 0)
+        first = id;
+      made++;
+    }
+    reply(fd, "OK %d first=%d", made, first);
+  } else if (strcmp(cmd, "step") == 0) {
+    if (n < 2 || b < 0) {
+      reply(fd, "ERR usage: step <id> [turns]");
+      return 0;
+    }
+    int ret = schedule_game(a, n >= 3 ? b : 1);
+    if (ret == -2)
+      reply(fd, "ERR game over");
+    else if (ret < 0)
+      reply(fd, "ERR no such game");
+    else
+      reply(fd, "OK");
+  } else if (strcmp(cmd, "finish") == 0) {
+    if (strcmp(arg1, "all") == 0) {
+      reply(fd, "OK %d", for_all_games(schedule_game, RUN_FOREVER));
+      return 0;
+    }
+    int ret = n < 2 ? -1 : schedule_game(a, RUN_FOREVER);
+    if (ret == -2)
+      reply(fd, "ERR game over");
+    else if (ret < 0)
+      reply(fd, "ERR no such game");
+    else
+      reply(fd, "OK");
+  } else if (strcmp(cmd, "wait") == 0) {
+    pthread_mutex_lock(&queue_lock);
+    while (outstanding > 0 && !stopping)
+      pthread_cond_wait(&idle_cond, &queue_lock);
+    pthread_mutex_unlock(&queue_lock);
+    reply(fd, "OK");
+  } else if (strcmp(cmd, "state") == 0) {
+    reply_state(fd, n < 2 ? -1 : a);
+  } else if (strcmp(cmd, "drop") == 0) {
+    if (strcmp(arg1, "all") == 0)
+      reply(fd, "OK %d", for_all_games(drop_game, 0));
+    else if (n < 2 || free_game(a) < 0)
+      reply(fd, "ERR no such idle game");
+    else
+      reply(fd, "OK");
+  } else if (strcmp(cmd, "stats") == 0) {
+    pthread_mutex_lock(&queue_lock);
+    int queued = queue_len, busy = outstanding;
+    pthread_mutex_unlock(&queue_lock);
+    reply(fd, "OK games=%d slabs=%d queued=%d busy=%d turns=%lu finished=%lu "
+              "threads=%d",
+          atomic_load_explicit(&games_live, memory_order_relaxed),
+          atomic_load_explicit(&num_slabs, memory_order_relaxed), queued, busy,
+          atomic_load_explicit(&total_turns, memory_order_relaxed),
+          atomic_load_explicit(&games_finished, memory_order_relaxed),
+          num_threads);
+  } else if (strcmp(cmd, "quit") == 0) {
+    reply(fd, "OK bye");
+    return 1;
+  } else if (strcmp(cmd, "shutdown") == 0) {
+    reply(fd, "OK shutting down");
+    should_exit = 1;
+    shutdown(listen_fd, SHUT_RDWR);
+    return 1;
+  } else {
+    reply(fd, "ERR unknown command '%s'", cmd);
+  }
+  return 0;
+}
+
+void *client_thread(void *arg) {
+  int fd = (int)(long)arg;
+  char buffer[4096];
+  int len = 0;
+
+  while (1) {
+    int n = read(fd, buffer + len, sizeof(buffer) - 1 - len);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      break;
+    len += n;
+    buffer[len] = '\0';
+
+    // handle every complete line, keep the rest for the next read
+    char *start = buffer, *nl;
+    int close_it = 0;
+    while (!close_it && (nl = strchr(start, '\n')) != NULL) {
+      *nl = '\0';
+      if (nl > start && nl[-1] == '\r')
+        nl[-1] = '\0';
+      close_it = handle_command(fd, start);
+      start = nl + 1;
+    }
+    if (close_it)
+      break;
+    len -= start - buffer;
+    memmove(buffer, start, len);
+    if (len == sizeof(buffer) - 1)
+      len = 0; // overlong line, drop it
+  }
+
+  close(fd);
+  return NULL;
+}
+
+int create_socket() {
+  listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listen_fd < 0) {
+    perror("socket");
+    return -1;
+  }
+
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, socket_path, sizeof(addr.sun_path) - 1);
+  unlink(socket_path);
+
+  if (bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    perror("bind");
+    return -1;
+  }
+  if (listen(listen_fd, 64) < 0) {
+    perror("listen");
+    return -1;
+  }
+  return 0;
+}
+
+void print_usage(char *prog_name) {
+  printf("Usage: %s [-s socket] [-t threads] [-b board] [-n games] [-H]\n",
+         prog_name);
+  printf("  -s socket   control socket (default: %s)\n", DEFAULT_SOCKET);
+  printf("  -t threads  worker threads (default: 4)\n");
+  printf("  -b board    board file (default: ludo.txt)\n");
+  printf("  -n games    arena capacity in games (default: %d)\n",
+         DEFAULT_MAX_GAMES);
+  printf("  -H          back the arena with 2MB hugepages\n");
+  printf("\nCommands on the socket (one per line):\n");
+  printf("  new <players> [seed]      - Create a game, replies with its id\n");
+  printf("  spawn <count> <players>   - Create many games at once\n");
+  printf("  step <id> [turns]         - Queue turns for a game\n");
+  printf("  finish <id>|all           - Play game(s) until everyone finishes\n");
+  printf("  wait                      - Block until no game has work queued\n");
+  printf("  state <id>                - Show a game's positions\n");
+  printf("  drop <id>|all             - Free idle game(s)\n");
+  printf("  stats                     - Server-wide counters\n");
+  printf("  quit | shutdown           - Close connection | stop server\n");
+}
+
+int main(int argc, char *argv[]) {
+  const char *board_file = "ludo.txt";
+  int opt;
+
+  while ((opt = getopt(argc, argv, "s:t:b:n:Hh")) != -1) {
+    switch (opt) {
+    case 's':
+      socket_path = optarg;
+      break;
+    case 't':
+      num_threads = atoi(optarg);
+      break;
+    case 'b':
+      board_file = optarg;
+      break;
+    case 'n':
+      max_games = atoi(optarg);
+      break;
+    case 'H':
+      use_hugepages = 1;
+      break;
+    default:
+      print_usage(argv[0]);
+      return opt == 'h' ? 0 : 1;
+    }
+  }
+  if (num_threads < 1) {
+    fprintf(stderr, "Error: need at least one worker thread\n");
+    return 1;
+  }
+  // whole slabs only
+  max_games = (max_games + SLAB_GAMES - 1) / SLAB_GAMES * SLAB_GAMES;
+  if (max_games < SLAB_GAMES)
+    max_games = SLAB_GAMES;
+
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = sigint_handler; // no SA_RESTART so accept() returns
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+  signal(SIGPIPE, SIG_IGN);
+
+  if (load_shared_board(board_file) < 0)
+    return 1;
+  if (create_arena() < 0)
+    return 1;
+  if (create_socket() < 0)
+    return 1;
+
+  pthread_t workers[num_threads];
+  for (int i = 0; i < num_threads; i++)
+    pthread_create(&workers[i], NULL, worker_thread, NULL);
+
+  printf("+++ Server: %d worker threads, %d game slots, listening on %s\n",
+         num_threads, max_games, socket_path);
+  fflush(stdout);
+
+  while (!should_exit) {
+    int fd = accept(listen_fd, NULL, NULL);
+    if (fd < 0) {
+      if (errno == EINTR || errno == ECONNABORTED)
+        continue;
+      if (!should_exit)
+        perror("accept");
+      break;
+    }
+
+    pthread_t tid;
+    if (pthread_create(&tid, NULL, client_thread, (void *)(long)fd) != 0) {
+      close(fd);
+      continue;
+    }
+    pthread_detach(tid);
+  }
+
+  printf("\n+++ Server: Shutting down...\n");
+  pthread_mutex_lock(&queue_lock);
+  stopping = 1;
+  pthread_cond_broadcast(&queue_cond);
+  pthread_cond_broadcast(&idle_cond);
+  pthread_mutex_unlock(&queue_lock);
+  for (int i = 0; i < num_threads; i++)
+    pthread_join(workers[i], NULL);
+
+  close(listen_fd);
+  unlink(socket_path);
+  printf("+++ Server: %lu turns played, %lu games finished. Goodbye!\n",
+         atomic_load(&total_turns), atomic_load(&games_finished));
+  return 0;
+}
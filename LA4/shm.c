@@ -0,0 +1,159 @@
+/*
+ * shm.c - Shared memory segments for Snake Ludo
+ * CS39002 Operating Systems Laboratory
+ *
+ * Author: Ashutosh Sharma
+ * Roll: 23CS10005
+ */
+
+#define _GNU_SOURCE
+#include "shm.h"
+
+#include <ctype.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define HUGE_PAGE_SIZE (2UL << 20) // default x86-64 hugepage size
+
+// create a memfd of size bytes, returns the fd or -1
+int shm_segment_create(const char *name, size_t size, int flags) {
+  int fd = -1;
+
+  if (flags & SHM_HUGE) {
+    size_t huge_size = (size + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+    fd = memfd_create(name, MFD_CLOEXEC | MFD_HUGETLB);
+    if (fd >= 0 && ftruncate(fd, huge_size) == 0) {
+      // hugetlb pages are only reserved at mmap time, so check it now
+      void *probe = mmap(NULL, huge_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                         fd, 0);
+      if (probe != MAP_FAILED) {
+        munmap(probe, huge_size);
+        return fd;
+      }
+    }
+    if (fd >= 0)
+      close(fd);
+    fprintf(stderr, "%s: no hugepages available, using normal pages\n", name);
+  }
+
+  fd = memfd_create(name, MFD_CLOEXEC |
+                             ((flags & SHM_SEALABLE) ? MFD_ALLOW_SEALING : 0));
+  if (fd < 0) {
+    perror("memfd_create");
+    return -1;
+  }
+  if (ftruncate(fd, size) < 0) {
+    perror("ftruncate (shm)");
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+void *shm_segment_map(int fd, size_t size, int writable) {
+  void *addr = mmap(NULL, size, writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                    MAP_SHARED, fd, 0);
+  if (addr == MAP_FAILED) {
+    perror("mmap (shm)");
+    return NULL;
+  }
+  return addr;
+}
+
+// make a segment permanently read-only; no writable mapping may exist
+int shm_segment_seal(int fd) {
+  if (fcntl(fd, F_ADD_SEALS,
+            F_SEAL_WRITE | F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) < 0) {
+    perror("fcntl (F_ADD_SEALS)");
+    return -1;
+  }
+  return 0;
+}
+
+// path another process can open to reach this segment
+int shm_segment_path(int fd, char *path) {
+  return snprintf(path, SHM_PATH_LEN, "/proc/%d/fd/%d", getpid(), fd);
+}
+
+// open a segment by path, returns the fd and stores its size
+int shm_segment_open(const char *path, int writable, size_t *size) {
+  int fd = open(path, writable ? O_RDWR : O_RDONLY);
+  if (fd < 0) {
+    perror("open (shm)");
+    return -1;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) < 0) {
+    perror("fstat (shm)");
+    close(fd);
+    return -1;
+  }
+  *size = st.st_size;
+  return fd;
+}
+
+// look for a memfd called name among the open fds of pid, or of any
+// process if pid is 0; returns the owner and stores the path
+pid_t shm_segment_find(pid_t pid, const char *name, char *path) {
+  char want[64], dir[64], link[SHM_PATH_LEN], target[256];
+  snprintf(want, sizeof(want), "/memfd:%s ", name);
+
+  DIR *proc = NULL;
+  if (pid == 0) {
+    proc = opendir("/proc");
+    if (proc == NULL) {
+      perror("opendir (/proc)");
+      return -1;
+    }
+  }
+
+  while (1) {
+    pid_t cur = pid;
+    if (proc != NULL) {
+      struct dirent *e = readdir(proc);
+      if (e == NULL)
+        break;
+      if (!isdigit((unsigned char)e->d_name[0]) || atoi(e->d_name) == getpid())
+        continue;
+      cur = atoi(e->d_name);
+    }
+
+    snprintf(dir, sizeof(dir), "/proc/%d/fd", cur);
+    DIR *fds = opendir(dir);
+    if (fds != NULL) {
+      struct dirent *f;
+      while ((f = readdir(fds)) != NULL) {
+        if (!isdigit((unsigned char)f->d_name[0]))
+          continue;
+        snprintf(link, sizeof(link), "/proc/%d/fd/%d", cur,
+                 atoi(f->d_name));
+        ssize_t n = readlink(link, target, sizeof(target) - 2);
+        if (n <= 0)
+          continue;
+        target[n] = ' '; // match "name" but not "name-other"
+        target[n + 1] = '\0';
+        if (strncmp(target, want, strlen(want)) == 0) {
+          strcpy(path, link);
+          closedir(fds);
+          if (proc != NULL)
+            closedir(proc);
+          return cur;
+        }
+      }
+      closedir(fds);
+    }
+    if (proc == NULL)
+      break;
+  }
+
+  if (proc != NULL)
+    closedir(proc);
+  return -1;
+}
@@ -0,0 +1,31 @@
+/*
+ * shm.h - Shared memory segments for Snake Ludo
+ * CS39002 Operating Systems Laboratory
+ *
+ * Segments are anonymous memfds instead of fixed SysV keys, so they
+ * disappear with the last process that holds them. Children reach them
+ * through /proc/<pid>/fd/<fd> of the coordinator.
+ *
+ * Author: Ashutosh Sharma
+ * Roll: 23CS10005
+ */
+
+#ifndef SHM_H
+#define SHM_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+#define SHM_SEALABLE 0x1 // segment can later be sealed read-only
+#define SHM_HUGE 0x2     // try MAP_HUGETLB backing, fall back to 4K pages
+
+#define SHM_PATH_LEN 64
+
+int shm_segment_create(const char *name, size_t size, int flags);
+void *shm_segment_map(int fd, size_t size, int writable);
+int shm_segment_seal(int fd);
+int shm_segment_path(int fd, char *path);
+int shm_segment_open(const char *path, int writable, size_t *size);
+pid_t shm_segment_find(pid_t pid, const char *name, char *path);
+
+#endif
@@ -0,0 +1,397 @@
+/*
+ * sim.c - Monte Carlo simulator for Snake Ludo boards
+ * CS39002 Operating Systems Laboratory
+ *
+ * Plays many headless games on a board and reports how long they last
+ * and who finishes first. Games run through the batched simulator in
+ * batch.c; -e engine plays them one at a time with game_turn() instead,
+ * and -c times both on the same workload.
+ *
+ * Game i always rolls from dice stream i of the seed (rng.h), so runs are
+ * reproducible and two boards can be played on the same dice: -B plays a
+ * second board on the same streams and estimates the difference from
+ * paired games. -a pairs every game with an antithetic twin that rolls
+ * 7 - die. -w keeps playing rounds of games until the confidence interval
+ * is narrower than asked. -v plays a house rules variant from engine.c
+ * on the engine.
+ *
+ * Author: Ashutosh Sharma
+ * Roll: 23CS10005
+ */
+
+#include "batch.h"
+#include "engine.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_LANES 1024
+#define DEFAULT_ROUND 10000
+
+// running mean and variance (Welford)
+struct estimate {
+  long n;
+  double mean;
+  double m2;
+};
+
+static int board[BOARD_SIZE];
+static int other[BOARD_SIZE]; // -B board
+static int num_players;
+static int threads;
+static int lanes = DEFAULT_LANES;
+static int use_engine;
+static turn_fn turn = game_turn; // -v variant
+static double z = 1.96; // 95% two-sided
+
+static double now_sec() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void estimate_add(struct estimate *e, double x) {
+  e->n++;
+  double d = x - e->mean;
+  e->mean += d / e->n;
+  e->m2 += d * (x - e->mean);
+}
+
+static double estimate_var(const struct estimate *e) {
+  return e->n > 1 ? e->m2 / (e->n - 1) : 0;
+}
+
+// confidence interval half-width of the mean
+static double estimate_half(const struct estimate *e) {
+  return e->n > 1 ? z * sqrt(estimate_var(e) / e->n) : INFINITY;
+}
+
+// one game at a time, as players.c would play it
+static void engine_run(const int *on, const struct sim_range *range,
+                       int32_t *lengths, struct sim_result *res) {
+  struct game g;
+  struct turn t;
+
+  for (long i = 0; i < range->count; i++) {
+    game_init(&g, num_players, rng_stream(range->seed, range->first + i));
+    int first = 0, winner = 0;
+    while (turn(on, &g, &t) == 0) {
+      if (t.rank == 1) {
+        first = g.turns;
+        winner = t.player;
+      }
+    }
+    res->games++;
+    res->turns += g.turns;
+    res->len_sq += (double)g.turns * g.turns;
+    res->win_turns += first;
+    res->win_sq += (double)first * first;
+    res->wins[winner]++;
+    if (lengths != NULL)
+      lengths[i] = g.turns;
+  }
+}
+
+// returns -1 if some of the range was not played
+static int play(const int *on, const struct sim_range *range,
+                int32_t *lengths, struct sim_result *res) {
+  if (use_engine) {
+    engine_run(on, range, lengths, res);
+    return 0;
+  }
+  return batch_simulate(on, num_players, range, threads, lanes, lengths, res);
+}
+
+static void print_result(const struct sim_result *res) {
+  double n = res->games;
+  double mean = res->turns / n;
+  double sd = sqrt(res->len_sq / n - mean * mean);
+  double win = res->win_turns / n;
+  double win_sd = sqrt(res->win_sq / n - win * win);
+
+  printf("games            %lu\n", res->games);
+  printf("turns per game   %.2f (sd %.2f)\n", mean, sd);
+  printf("first finish     %.2f turns (sd %.2f)\n", win, win_sd);
+  printf("first finisher  ");
+  for (int p = 0; p < num_players; p++)
+    printf(" %c:%.1f%%", 'A' + p, 100.0 * res->wins[p] / n);
+  printf("\n");
+}
+
+// same games through each implementation, single-threaded; returns -1 if
+// a kernel failed to play them
+static int compare(long games, uint64_t seed) {
+  struct sim_result res;
+  struct sim_range range = {seed, 0, games, 0};
+  double base = 0;
+  const char *kernels[] = {"engine", "scalar", "avx2"};
+
+  printf("%-8s %12s %12s %10s\n", "kernel", "games/s", "turns/game",
+         "speedup");
+  for (int k = 0; k < 3; k++) {
+    memset(&res, 0, sizeof(res));
+    double start = now_sec();
+    if (k == 0) {
+      engine_run(board, &range, NULL, &res);
+    } else {
+      if (batch_select(kernels[k]) < 0) {
+        printf("%-8s %12s\n", kernels[k], "unsupported");
+        continue;
+      }
+      if (batch_simulate(board, num_players, &range, 1, lanes, NULL, &res) <
+          0) {
+        fprintf(stderr, "Error: the %s kernel failed\n", kernels[k]);
+        return -1;
+      }
+    }
+    double rate = games / (now_sec() - start);
+    if (k == 0)
+      base = rate;
+    printf("%-8s %12.0f %12.2f %9.1fx\n", kernels[k], rate,
+           (double)res.turns / res.games, rate / base);
+  }
+  return 0;
+}
+
+void print_usage(char *prog_name) {
+  printf("Usage: %s [-b board] [-B board] [-g games] [-w width] [-r round]"
+         "\n          [-a] [-z z] [-s seed] [-t threads] [-k lanes]"
+         "\n          [-e avx2|scalar|engine] [-v variant] [-c] "
+         "<num_players>\n",
+         prog_name);
+  printf("  -b board    board file (default: ludo.txt)\n");
+  printf("  -B board    second board, played on the same dice; reports the\n"
+         "              difference in mean length\n");
+  printf("  -g games    games to play, or the most to play with -w "
+         "(default: 100000)\n");
+  printf("  -w width    stop once the interval half-width is below width "
+         "turns\n");
+  printf("  -r round    games between stopping checks (default: %d)\n",
+         DEFAULT_ROUND);
+  printf("  -a          antithetic pairs: every other game rolls 7 - die\n");
+  printf("  -z z        interval width in standard errors (default: 1.96)\n");
+  printf("  -s seed     dice seed (default: time)\n");
+  printf("  -t threads  simulator threads (default: online CPUs)\n");
+  printf("  -k lanes    games in flight per thread (default: %d)\n",
+         DEFAULT_LANES);
+  printf("  -e kernel   avx2 or scalar batch steps, or the per-game engine\n");
+  printf("  -v variant  house rules, played on the engine:\n             ");
+  for (int i = 0; i < num_rules_variants; i++)
+    printf(" %s", rules_variants[i].name);
+  printf("\n");
+  printf("  -c          compare engine and batch throughput (one thread)\n");
+}
+
+int main(int argc, char *argv[]) {
+  const char *board_file = "ludo.txt";
+  const char *other_file = NULL;
+  const char *kernel = NULL;
+  const struct rules_variant *variant = NULL;
+  long games = 100000;
+  long round = DEFAULT_ROUND;
+  double width = 0;
+  int antithetic = 0;
+  uint64_t seed = time(NULL);
+  int do_compare = 0;
+  int opt;
+
+  threads = sysconf(_SC_NPROCESSORS_ONLN);
+  while ((opt = getopt(argc, argv, "b:B:g:w:r:az:s:t:k:e:v:ch")) != -1) {
+    switch (opt) {
+    case 'b':
+      board_file = optarg;
+      break;
+    case 'B':
+      other_file = optarg;
+      break;
+    case 'g':
+      games = atol(optarg);
+      break;
+    case 'w':
+      width = atof(optarg);
+      break;
+    case 'r':
+      round = atol(optarg);
+      break;
+    case 'a':
+      antithetic = 1;
+      break;
+    case 'z':
+      z = atof(optarg);
+      break;
+    case 's':
+      seed = strtoull(optarg, NULL, 0);
+      break;
+    case 't':
+      threads = atoi(optarg);
+      break;
+    case 'k':
+      lanes = atoi(optarg);
+      break;
+    case 'e':
+      kernel = optarg;
+      break;
+    case 'v':
+      variant = rules_find(optarg);
+      if (variant == NULL) {
+        fprintf(stderr, "Error: unknown variant %s\n", optarg);
+        return 1;
+      }
+      break;
+    case 'c':
+      do_compare = 1;
+      break;
+    default:
+      print_usage(argv[0]);
+      return opt == 'h' ? 0 : 1;
+    }
+  }
+  if (optind >= argc) {
+    print_usage(argv[0]);
+    return 1;
+  }
+  num_players = atoi(argv[optind]);
+  if (num_players < 2 || num_players > MAX_PLAYERS) {
+    fprintf(stderr, "Error: Number of players must be between 2 and %d\n",
+            MAX_PLAYERS);
+    return 1;
+  }
+  if (games < 1 || threads < 1 || lanes < 1 || round < 2 || z <= 0) {
+    fprintf(stderr, "Error: games, threads, lanes, round and z must be "
+                    "positive\n");
+    return 1;
+  }
+  if (board_load(board, board_file) < 0)
+    return 1;
+  if (other_file != NULL && board_load(other, other_file) < 0)
+    return 1;
+
+  if (do_compare)
+    return compare(games, seed) < 0 ? 1 : 0;
+
+  // the batch kernels only know the classic rules
+  if (variant != NULL && variant->turn != game_turn) {
+    if (kernel != NULL && strcmp(kernel, "engine") != 0) {
+      fprintf(stderr, "Error: variant %s needs the engine kernel\n",
+              variant->name);
+      return 1;
+    }
+    kernel = "engine";
+    turn = variant->turn;
+  }
+
+  if (kernel != NULL && strcmp(kernel, "engine") == 0) {
+    if (antithetic) {
+      fprintf(stderr, "Error: antithetic games need a batch kernel\n");
+      return 1;
+    }
+    use_engine = 1;
+  } else {
+    if (kernel != NULL && batch_select(kernel) < 0) {
+      fprintf(stderr, "Error: kernel %s not available\n", kernel);
+      return 1;
+    }
+    kernel = batch_name();
+  }
+
+  // pairs must not straddle rounds
+  if (antithetic) {
+    round += round & 1;
+    games += games & 1;
+  }
+  int32_t *len_a = malloc(round * sizeof(int32_t));
+  int32_t *len_b = malloc(round * sizeof(int32_t));
+  if (len_a == NULL || len_b == NULL) {
+    perror("malloc");
+    return 1;
+  }
+
+  // est holds the samples the interval is built from: one per game, or
+  // one per antithetic pair, of a length or a paired difference
+  struct estimate est = {0}, game_a = {0}, game_b = {0};
+  struct sim_result res_a, res_b;
+  memset(&res_a, 0, sizeof(res_a));
+  memset(&res_b, 0, sizeof(res_b));
+  int step = antithetic ? 2 : 1;
+  double start = now_sec();
+  long played = 0;
+
+  while (played < games) {
+    struct sim_range range = {seed, played, round, antithetic};
+    if (range.count > games - played)
+      range.count = games - played;
+
+    if (play(board, &range, len_a, &res_a) < 0 ||
+        (other_file != NULL && play(other, &range, len_b, &res_b) < 0)) {
+      fprintf(stderr, "Error: games %ld-%ld could not all be played\n",
+              range.first, range.first + range.count - 1);
+      free(len_a);
+      free(len_b);
+      return 1;
+    }
+
+    for (long i = 0; i < range.count; i += step) {
+      double a = len_a[i], b = 0;
+      estimate_add(&game_a, len_a[i]);
+      if (antithetic) {
+        estimate_add(&game_a, len_a[i + 1]);
+        a = (a + len_a[i + 1]) / 2;
+      }
+      if (other_file != NULL) {
+        b = len_b[i];
+        estimate_add(&game_b, len_b[i]);
+        if (antithetic) {
+          estimate_add(&game_b, len_b[i + 1]);
+          b = (b + len_b[i + 1]) / 2;
+        }
+      }
+      estimate_add(&est, a - b);
+    }
+    played += range.count;
+
+    if (width > 0) {
+      printf("+++ Sim: %ld games, +/- %.3f\n", played, estimate_half(&est));
+      fflush(stdout);
+      if (estimate_half(&est) <= width)
+        break;
+    }
+  }
+
+  double elapsed = now_sec() - start;
+  long runs = other_file != NULL ? 2 * played : played;
+  printf("+++ Sim: %d players, %s kernel, %s rules, %.3f s (%.0f games/s)\n",
+         num_players, use_engine ? "engine" : kernel,
+         variant != NULL ? variant->name : "classic", elapsed,
+         runs / elapsed);
+
+  // what independent games would have given for the same number of games
+  double plain = estimate_var(&game_a) + estimate_var(&game_b);
+  double got = estimate_var(&est) * step;
+
+  if (other_file == NULL) {
+    print_result(&res_a);
+    printf("mean length      %.3f +/- %.3f (z %.2f)\n", est.mean,
+           estimate_half(&est), z);
+  } else {
+    printf("%-16s %.3f\n", board_file, game_a.mean);
+    printf("%-16s %.3f\n", other_file, game_b.mean);
+    printf("difference       %.3f +/- %.3f (z %.2f, paired on the same "
+           "dice)\n",
+           est.mean, estimate_half(&est), z);
+    printf("independent      +/- %.3f\n", z * sqrt(plain / played));
+  }
+  if ((other_file != NULL || antithetic) && got > 0)
+    printf("variance ratio   %.2fx fewer games for the same interval\n",
+           plain / got);
+  if (width > 0 && estimate_half(&est) > width)
+    printf("+++ Sim: stopped at %ld games before reaching +/- %.3f\n", played,
+           width);
+
+  free(len_a);
+  free(len_b);
+  return 0;
+}
@@ -0,0 +1,169 @@
+/*
+ * simd.c - Occupancy and active-player scans over uint16_t positions
+ * CS39002 Operating Systems Laboratory
+ *
+ * Author: Ashutosh Sharma
+ * Roll: 23CS10005
+ */
+
+#include "simd.h"
+
+#include <immintrin.h>
+#include <string.h>
+
+typedef int (*any_fn)(const uint16_t *, int, int, int);
+typedef int (*find_ne_fn)(const uint16_t *, int, int, int);
+
+int occ_any_scalar(const uint16_t *pos, int n, int cell, int skip) {
+  for (int i = 0; i < n; i++) {
+    if (pos[i] == cell && i != skip)
+      return 1;
+  }
+  return 0;
+}
+
+int occ_find_ne_scalar(const uint16_t *pos, int from, int n, int value) {
+  for (int i = from; i < n; i++) {
+    if (pos[i] != value)
+      return i;
+  }
+  return -1;
+}
+
+// clear the two mask bits of lane skip - base if it is in this vector
+static inline uint32_t drop_lane(uint32_t mask, int skip, int base,
+                                 int lanes) {
+  unsigned lane = (unsigned)(skip - base);
+  return lane < (unsigned)lanes ? mask & ~(3u << (2 * lane)) : mask;
+}
+
+__attribute__((target("sse4.1"))) int
+occ_any_sse4(const uint16_t *pos, int n, int cell, int skip) {
+  __m128i c = _mm_set1_epi16(cell);
+  int i = 0;
+
+  for (; i + 32 <= n; i += 32) {
+    __m128i e0 = _mm_cmpeq_epi16(_mm_loadu_si128((void *)(pos + i)), c);
+    __m128i e1 = _mm_cmpeq_epi16(_mm_loadu_si128((void *)(pos + i + 8)), c);
+    __m128i e2 = _mm_cmpeq_epi16(_mm_loadu_si128((void *)(pos + i + 16)), c);
+    __m128i e3 = _mm_cmpeq_epi16(_mm_loadu_si128((void *)(pos + i + 24)), c);
+    __m128i any = _mm_or_si128(_mm_or_si128(e0, e1), _mm_or_si128(e2, e3));
+    if (_mm_testz_si128(any, any))
+      continue;
+    __m128i e[4] = {e0, e1, e2, e3};
+    for (int k = 0; k < 4; k++) {
+      if (drop_lane(_mm_movemask_epi8(e[k]), skip, i + 8 * k, 8))
+        return 1;
+    }
+  }
+  for (; i + 8 <= n; i += 8) {
+    __m128i eq = _mm_cmpeq_epi16(_mm_loadu_si128((void *)(pos + i)), c);
+    if (drop_lane(_mm_movemask_epi8(eq), skip, i, 8))
+      return 1;
+  }
+  return occ_any_scalar(pos + i, n - i, cell, skip - i);
+}
+
+__attribute__((target("sse4.1"))) int
+occ_find_ne_sse4(const uint16_t *pos, int from, int n, int value) {
+  __m128i v = _mm_set1_epi16(value);
+  int i = from;
+
+  for (; i + 8 <= n; i += 8) {
+    __m128i eq = _mm_cmpeq_epi16(_mm_loadu_si128((void *)(pos + i)), v);
+    uint32_t ne = ~_mm_movemask_epi8(eq) & 0xffff;
+    if (ne)
+      return i + __builtin_ctz(ne) / 2;
+  }
+  return occ_find_ne_scalar(pos, i, n, value);
+}
+
+__attribute__((target("avx2"))) int
+occ_any_avx2(const uint16_t *pos, int n, int cell, int skip) {
+  __m256i c = _mm256_set1_epi16(cell);
+  int i = 0;
+
+  for (; i + 64 <= n; i += 64) {
+    __m256i e0 = _mm256_cmpeq_epi16(_mm256_loadu_si256((void *)(pos + i)), c);
+    __m256i e1 =
+        _mm256_cmpeq_epi16(_mm256_loadu_si256((void *)(pos + i + 16)), c);
+    __m256i e2 =
+        _mm256_cmpeq_epi16(_mm256_loadu_si256((void *)(pos + i + 32)), c);
+    __m256i e3 =
+        _mm256_cmpeq_epi16(_mm256_loadu_si256((void *)(pos + i + 48)), c);
+    __m256i any =
+        _mm256_or_si256(_mm256_or_si256(e0, e1), _mm256_or_si256(e2, e3));
+    if (_mm256_testz_si256(any, any))
+      continue;
+    __m256i e[4] = {e0, e1, e2, e3};
+    for (int k = 0; k < 4; k++) {
+      if (drop_lane(_mm256_movemask_epi8(e[k]), skip, i + 16 * k, 16))
+        return 1;
+    }
+  }
+  for (; i + 16 <= n; i += 16) {
+    __m256i eq = _mm256_cmpeq_epi16(_mm256_loadu_si256((void *)(pos + i)), c);
+    if (drop_lane(_mm256_movemask_epi8(eq), skip, i, 16))
+      return 1;
+  }
+  return occ_any_scalar(pos + i, n - i, cell, skip - i);
+}
+
+__attribute__((target("avx2"))) int
+occ_find_ne_avx2(const uint16_t *pos, int from, int n, int value) {
+  __m256i v = _mm256_set1_epi16(value);
+  int i = from;
+
+  for (; i + 16 <= n; i += 16) {
+    __m256i eq = _mm256_cmpeq_epi16(_mm256_loadu_si256((void *)(pos + i)), v);
+    uint32_t ne = ~(uint32_t)_mm256_movemask_epi8(eq);
+    if (ne)
+      return i + __builtin_ctz(ne) / 2;
+  }
+  return occ_find_ne_scalar(pos, i, n, value);
+}
+
+static any_fn any_impl = occ_any_scalar;
+static find_ne_fn find_ne_impl = occ_find_ne_scalar;
+static const char *impl_name = "scalar";
+
+int simd_select(const char *name) {
+  __builtin_cpu_init();
+  if (strcmp(name, "avx2") == 0 && __builtin_cpu_supports("avx2")) {
+    any_impl = occ_any_avx2;
+    find_ne_impl = occ_find_ne_avx2;
+  } else if (strcmp(name, "sse4") == 0 && __builtin_cpu_supports("sse4.1")) {
+    any_impl = occ_any_sse4;
+    find_ne_impl = occ_find_ne_sse4;
+  } else if (strcmp(name, "scalar") == 0) {
+    any_impl = occ_any_scalar;
+    find_ne_impl = occ_find_ne_scalar;
+  } else {
+    return -1;
+  }
+  impl_name = name;
+  return 0;
+}
+
+// best kernels for this CPU, before main() runs
+__attribute__((constructor)) static void simd_init() {
+  if (simd_select("avx2") < 0 && simd_select("sse4") < 0)
+    simd_select("scalar");
+}
+
+const char *simd_name() { return impl_name; }
+
+int occ_any(const uint16_t *pos, int n, int cell, int skip) {
+  return any_impl(pos, n, cell, skip);
+}
+
+int occ_find_ne(const uint16_t *pos, int from, int n, int value) {
+  return find_ne_impl(pos, from, n, value);
+}
+
+int occ_next_active(const uint16_t *pos, int n, int current, int finish) {
+  int next = find_ne_impl(pos, current + 1, n, finish);
+  if (next < 0)
+    next = find_ne_impl(pos, 0, current + 1 < n ? current + 1 : n, finish);
+  return next;
+}
@@ -0,0 +1,32 @@
+/*
+ * simd.h - Occupancy and active-player scans over uint16_t positions
+ * CS39002 Operating Systems Laboratory
+ *
+ * AVX2 (16 positions per compare), SSE4.1 (8) and scalar versions of the
+ * two linear scans in the turn loop, picked at startup from what the CPU
+ * supports.
+ *
+ * Author: Ashutosh Sharma
+ * Roll: 23CS10005
+ */
+
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <stdint.h>
+
+// is any token other than pos[skip] on cell (skip = -1 checks all)
+int occ_any(const uint16_t *pos, int n, int cell, int skip);
+
+// first index >= from whose position is not value, or -1
+int occ_find_ne(const uint16_t *pos, int from, int n, int value);
+
+// next index after current (cyclic) not at finish, or -1 if none
+int occ_next_active(const uint16_t *pos, int n, int current, int finish);
+
+// name of the kernels in use; simd_select("scalar"|"sse4"|"avx2") forces
+// one (for benchmarks), returns -1 if the CPU lacks it
+const char *simd_name();
+int simd_select(const char *name);
+
+#endif
@@ -0,0 +1,464 @@
+/*
+ * solve.c - ludo-solve: exact win probabilities for 2 and 3 players
+ * CS39002 Operating Systems Laboratory
+ *
+ * Solves the game as a Markov chain over the joint positions instead of
+ * sampling it. A state is the positions of the players still playing, in
+ * turn order starting with the one to move, so one table serves every
+ * seat: after the mover's roll the state rotates to (next, ..., mover).
+ * Blocking, cancelled turns and chains are applied exactly as in
+ * game_turn(). Once a player finishes, the other two play on as a
+ * 2-player game, which is solved first.
+ *
+ * The values are found by Gauss-Seidel value iteration, sweeping states
+ * from the highest sum of positions down, since a move forward lands in
+ * a state with a larger sum that has already been updated. The table is
+ * indexed [a][b][c], so the states one roll leads to, (b, c, a + 1..17),
+ * sit next to each other in memory. A lost turn (three 6s, overshoot,
+ * blocked) only rotates the state, so the rotations of a state are solved
+ * together in closed form rather than iterated; that leaves snakes as
+ * the only thing feeding values back, and a few dozen sweeps settle the
+ * table. Nothing in a diagonal depends on another state of the same
+ * diagonal, so each one is split across threads with no scratch copy,
+ * and the result does not depend on the thread count.
+ *
+ * The answer is then checked against games played on the engine.
+ *
+ * Author: Ashutosh Sharma
+ * Roll: 23CS10005
+ */
+
+#include "engine.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define CELLS FINISH_CELL // positions 0-99 of a player still playing
+#define MAX_SUM (3 * (CELLS - 1))
+#define MAX_TOTALS 16
+
+// what a 3-player state is worth to the mover (0) and the next player
+// (1); the third player gets the rest of each
+struct value {
+  double first[2]; // finishes first
+  double last[2];  // finishes last
+};
+
+// the same for all three, in the order of some rotation of the state
+struct value3 {
+  double first[3];
+  double last[3];
+};
+
+static int board[BOARD_SIZE];
+static int num_players;
+static int threads;
+
+// dice totals of a turn and how likely each is (0 = cancelled)
+static int totals[MAX_TOTALS];
+static double probs[MAX_TOTALS];
+static int ntotals;
+
+// 2-player game: chance the mover finishes before the other
+static double win2[CELLS][CELLS];
+
+// snakes and ladders from each cell, as game_turn() would walk them on
+// an empty board; the walk stops early at an occupied cell
+static int path[BOARD_SIZE][BOARD_SIZE];
+static int path_len[BOARD_SIZE];
+
+// 3-player game, v3[a][b][c]
+static struct value (*v3)[CELLS][CELLS];
+static int diag_size[MAX_SUM + 1]; // states with each sum of positions
+
+static pthread_barrier_t barrier;
+static _Atomic int converged;
+static double tolerance = 1e-12;
+static double *worst; // largest change per thread this sweep
+static int sweeps3;
+
+static double now_sec() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void init_totals() {
+  for (int sixes = 0; sixes < 3; sixes++) {
+    for (int d = 1; d <= 5; d++) {
+      totals[ntotals] = 6 * sixes + d;
+      probs[ntotals++] = pow(1.0 / 6, sixes + 1);
+    }
+  }
+  totals[ntotals] = 0;
+  probs[ntotals++] = 1.0 / 216;
+
+  for (int cell = 1; cell < FINISH_CELL; cell++) {
+    unsigned char visited[BOARD_SIZE] = {0};
+    int to = cell;
+    while (to > 0 && to < FINISH_CELL && board[to] != 0 && !visited[to]) {
+      visited[to] = 1;
+      to += board[to];
+      path[cell][path_len[cell]++] = to;
+    }
+  }
+}
+
+// where the mover at a ends up with total, b and c on the board (-1 for
+// nobody); same rules as game_turn()
+static int move(int a, int b, int c, int total) {
+  int to = a + total;
+  if (total == 0 || to > FINISH_CELL)
+    return a;
+  if (to == FINISH_CELL)
+    return to;
+  if (to == b || to == c)
+    return a;
+
+  for (int h = 0; h < path_len[to]; h++) {
+    int next = path[to][h];
+    if (next > 0 && next < FINISH_CELL && (next == b || next == c))
+      break;
+    to = next;
+  }
+  return to;
+}
+
+// 2-player value of the rolls that get the mover somewhere; the chance
+// of staying put is left in *stay
+static double moves2(int a, int b, double *stay) {
+  double w = 0;
+  *stay = 0;
+  for (int k = 0; k < ntotals; k++) {
+    int to = move(a, b, -1, totals[k]);
+    if (to == a)
+      *stay += probs[k];
+    else
+      w += probs[k] * (to == FINISH_CELL ? 1 : 1 - win2[b][to]);
+  }
+  return w;
+}
+
+// 2-player table, sweeping a + b downwards until nothing changes. A lost
+// turn hands (a, b) over as (b, a), so each pair is solved from
+//   W(a,b) = S(a,b) + q(a,b) (1 - W(b,a))  and the same with a, b swapped
+int solve2() {
+  int sweeps = 0;
+  double change;
+  do {
+    change = 0;
+    for (int s = 2 * (CELLS - 1); s >= 0; s--) {
+      for (int a = s < CELLS ? s : CELLS - 1; a >= 0 && s - a < CELLS; a--) {
+        int b = s - a;
+        if (b < a)
+          continue; // done with (b, a)
+        double qa, qb;
+        double sa = moves2(a, b, &qa), sb = moves2(b, a, &qb);
+        double wa = (sa + qa * (1 - sb - qb)) / (1 - qa * qb);
+        double wb = sb + qb * (1 - wa);
+        change = fmax(change, fmax(fabs(wa - win2[a][b]),
+                                   fabs(wb - win2[b][a])));
+        win2[a][b] = wa;
+        win2[b][a] = wb;
+      }
+    }
+    sweeps++;
+  } while (change > tolerance);
+  return sweeps;
+}
+
+// 3-player value of the rolls that get the mover at a somewhere, in the
+// order (a, b, c); the chance of staying put is returned
+static double moves3(int a, int b, int c, struct value3 *v) {
+  double stay = 0;
+  memset(v, 0, sizeof(*v));
+  for (int k = 0; k < ntotals; k++) {
+    double p = probs[k];
+    int to = move(a, b, c, totals[k]);
+    if (to == a) {
+      stay += p;
+    } else if (to == FINISH_CELL) {
+      // the mover is first; b and c play on for last place
+      v->first[0] += p;
+      v->last[1] += p * (1 - win2[b][c]);
+      v->last[2] += p * win2[b][c];
+    } else {
+      // now b moves, then c, then the mover
+      const struct value *n = &v3[b][c][to];
+      v->first[0] += p * (1 - n->first[0] - n->first[1]);
+      v->first[1] += p * n->first[0];
+      v->first[2] += p * n->first[1];
+      v->last[0] += p * (1 - n->last[0] - n->last[1]);
+      v->last[1] += p * n->last[0];
+      v->last[2] += p * n->last[1];
+    }
+  }
+  return stay;
+}
+
+// out = s + q P y, where P turns a value in the order of the next
+// rotation, (b, c, a), into the order (a, b, c)
+static void rotate_add(struct value3 *out, const struct value3 *s, double q,
+                       const struct value3 *y) {
+  for (int i = 0; i < 3; i++) {
+    out->first[i] = s->first[i] + q * y->first[(i + 2) % 3];
+    out->last[i] = s->last[i] + q * y->last[(i + 2) % 3];
+  }
+}
+
+static double store3(int a, int b, int c, const struct value3 *x) {
+  struct value *v = &v3[a][b][c];
+  double d = fmax(fmax(fabs(x->first[0] - v->first[0]),
+                       fabs(x->first[1] - v->first[1])),
+                  fmax(fabs(x->last[0] - v->last[0]),
+                       fabs(x->last[1] - v->last[1])));
+  v->first[0] = x->first[0];
+  v->first[1] = x->first[1];
+  v->last[0] = x->last[0];
+  v->last[1] = x->last[1];
+  return d;
+}
+
+// (a, b, c) and its rotations, which lost turns cycle through:
+//   X0 = S0 + q0 P X1,  X1 = S1 + q1 P X2,  X2 = S2 + q2 P X0
+// and since P^3 = 1,
+//   X0 = (S0 + q0 P (S1 + q1 P S2)) / (1 - q0 q1 q2)
+// returns the largest change
+static double update_orbit(int a, int b, int c) {
+  struct value3 s0, s1, s2, x0, x1, x2, t;
+  double q0 = moves3(a, b, c, &s0);
+  double q1 = moves3(b, c, a, &s1);
+  double q2 = moves3(c, a, b, &s2);
+
+  rotate_add(&t, &s1, q1, &s2);
+  rotate_add(&x0, &s0, q0, &t);
+  double k = 1 / (1 - q0 * q1 * q2);
+  for (int i = 0; i < 3; i++) {
+    x0.first[i] *= k;
+    x0.last[i] *= k;
+  }
+  rotate_add(&x2, &s2, q2, &x0);
+  rotate_add(&x1, &s1, q1, &x2);
+
+  double d = store3(a, b, c, &x0);
+  d = fmax(d, store3(b, c, a, &x1));
+  return fmax(d, store3(c, a, b, &x2));
+}
+
+// lowest of its rotations, so each orbit is updated once
+static int orbit_first(int a, int b, int c) {
+  return (a < b || (a == b && (b < c || (b == c && c <= a)))) &&
+         (a < c || (a == c && (b < a || (b == a && c <= b))));
+}
+
+// this thread's share of each diagonal, every sweep until converged
+void *solve3_thread(void *arg) {
+  int id = (int)(long)arg;
+
+  while (!converged) {
+    worst[id] = 0;
+    for (int s = MAX_SUM; s >= 0; s--) {
+      int n = diag_size[s];
+      int lo = (long)n * id / threads, hi = (long)n * (id + 1) / threads;
+
+      // states a + b + c = s in a fixed order, this thread's from lo to hi
+      int i = 0;
+      for (int a = 0; a < CELLS && i < hi; a++) {
+        for (int b = 0; b < CELLS && i < hi; b++) {
+          int c = s - a - b;
+          if (c < 0 || c >= CELLS)
+            continue;
+          if (i >= lo && orbit_first(a, b, c))
+            worst[id] = fmax(worst[id], update_orbit(a, b, c));
+          i++;
+        }
+      }
+      pthread_barrier_wait(&barrier);
+    }
+
+    if (id == 0) {
+      sweeps3++;
+      double change = 0;
+      for (int t = 0; t < threads; t++)
+        change = fmax(change, worst[t]);
+      converged = change <= tolerance;
+    }
+    pthread_barrier_wait(&barrier);
+  }
+  return NULL;
+}
+
+int solve3() {
+  v3 = calloc(1, sizeof(struct value[CELLS][CELLS][CELLS]));
+  worst = calloc(threads, sizeof(double));
+  if (v3 == NULL || worst == NULL) {
+    perror("calloc");
+    return -1;
+  }
+
+  for (int a = 0; a < CELLS; a++)
+    for (int b = 0; b < CELLS; b++)
+      for (int c = 0; c < CELLS; c++)
+        diag_size[a + b + c]++;
+
+  pthread_t tids[threads];
+  pthread_barrier_init(&barrier, NULL, threads);
+  for (int t = 1; t < threads; t++) {
+    if (pthread_create(&tids[t], NULL, solve3_thread, (void *)(long)t) != 0) {
+      perror("pthread_create");
+      return -1;
+    }
+  }
+  solve3_thread(0);
+  for (int t = 1; t < threads; t++)
+    pthread_join(tids[t], NULL);
+  pthread_barrier_destroy(&barrier);
+  return sweeps3;
+}
+
+// first-finish and rank shares of games played on the engine
+void monte_carlo(long games, uint64_t seed, double *first, double *first_sd,
+                 double *rank, double *rank_sd) {
+  long wins[MAX_PLAYERS] = {0};
+  double sum[MAX_PLAYERS] = {0}, sq[MAX_PLAYERS] = {0};
+  struct game g;
+  struct turn t;
+
+  for (long i = 0; i < games; i++) {
+    game_init(&g, num_players, rng_stream(seed, i));
+    while (game_turn(board, &g, &t) == 0)
+      ;
+    for (int p = 0; p < num_players; p++) {
+      wins[p] += g.rank[p] == 1;
+      sum[p] += g.rank[p];
+      sq[p] += (double)g.rank[p] * g.rank[p];
+    }
+  }
+  for (int p = 0; p < num_players; p++) {
+    first[p] = (double)wins[p] / games;
+    first_sd[p] = sqrt(first[p] * (1 - first[p]) / games);
+    rank[p] = sum[p] / games;
+    rank_sd[p] = sqrt((sq[p] / games - rank[p] * rank[p]) / games);
+  }
+}
+
+void print_usage(char *prog_name) {
+  printf("Usage: %s [-b board] [-t threads] [-e tolerance] [-m games] "
+         "[-s seed]\n          <num_players>\n",
+         prog_name);
+  printf("  num_players: 2 or 3\n");
+  printf("  -b board      board file (default: ludo.txt)\n");
+  printf("  -t threads    solver threads (default: online CPUs)\n");
+  printf("  -e tolerance  stop once no value moves by more (default: 1e-12)"
+         "\n");
+  printf("  -m games      engine games to check against, 0 to skip "
+         "(default: 200000)\n");
+  printf("  -s seed       dice seed for the check (default: time)\n");
+}
+
+int main(int argc, char *argv[]) {
+  const char *board_file = "ludo.txt";
+  long games = 200000;
+  uint64_t seed = time(NULL);
+  int opt;
+
+  threads = sysconf(_SC_NPROCESSORS_ONLN);
+  while ((opt = getopt(argc, argv, "b:t:e:m:s:h")) != -1) {
+    switch (opt) {
+    case 'b':
+      board_file = optarg;
+      break;
+    case 't':
+      threads = atoi(optarg);
+      break;
+    case 'e':
+      tolerance = atof(optarg);
+      break;
+    case 'm':
+      games = atol(optarg);
+      break;
+    case 's':
+      seed = strtoull(optarg, NULL, 0);
+      break;
+    default:
+      print_usage(argv[0]);
+      return opt == 'h' ? 0 : 1;
+    }
+  }
+  if (optind >= argc) {
+    print_usage(argv[0]);
+    return 1;
+  }
+  num_players = atoi(argv[optind]);
+  if (num_players < 2 || num_players > 3) {
+    fprintf(stderr, "Error: the exact solver handles 2 or 3 players\n");
+    return 1;
+  }
+  if (threads < 1 || tolerance <= 0 || games < 0) {
+    fprintf(stderr, "Error: threads and tolerance must be positive\n");
+    return 1;
+  }
+  if (board_load(board, board_file) < 0)
+    return 1;
+  init_totals();
+
+  // exact first-finish and rank chances per seat, seat A to move
+  double first[3], rank[3];
+  double start = now_sec();
+  int sweeps2 = solve2(), sweeps = 0;
+  if (num_players == 2) {
+    first[0] = win2[0][0];
+    first[1] = 1 - first[0];
+    rank[0] = 2 - first[0];
+    rank[1] = 2 - first[1];
+  } else {
+    sweeps = solve3();
+    if (sweeps < 0)
+      return 1;
+    const struct value *v = &v3[0][0][0];
+    double last[3];
+    first[0] = v->first[0];
+    first[1] = v->first[1];
+    first[2] = 1 - first[0] - first[1];
+    last[0] = v->last[0];
+    last[1] = v->last[1];
+    last[2] = 1 - last[0] - last[1];
+    for (int p = 0; p < 3; p++)
+      rank[p] = 2 - first[p] + last[p]; // 1 P1 + 2 (1 - P1 - P3) + 3 P3
+  }
+  double elapsed = now_sec() - start;
+
+  printf("+++ Solve: %d players on %s, %d + %d sweeps, %d thread%s, "
+         "%.3f s\n",
+         num_players, board_file, sweeps2, sweeps, threads,
+         threads > 1 ? "s" : "", elapsed);
+
+  if (games == 0) {
+    printf("%-5s %12s %12s\n", "seat", "P(first)", "E[rank]");
+    for (int p = 0; p < num_players; p++)
+      printf("%-5c %12.9f %12.9f\n", 'A' + p, first[p], rank[p]);
+    return 0;
+  }
+
+  double mc_first[3], first_sd[3], mc_rank[3], rank_sd[3];
+  monte_carlo(games, seed, mc_first, first_sd, mc_rank, rank_sd);
+  printf("%-5s %12s %12s %7s %12s %12s %7s\n", "seat", "P(first)", "sampled",
+         "z", "E[rank]", "sampled", "z");
+  double worst_z = 0;
+  for (int p = 0; p < num_players; p++) {
+    double z1 = (mc_first[p] - first[p]) / first_sd[p];
+    double z2 = (mc_rank[p] - rank[p]) / rank_sd[p];
+    worst_z = fmax(worst_z, fmax(fabs(z1), fabs(z2)));
+    printf("%-5c %12.9f %12.6f %7.2f %12.9f %12.6f %7.2f\n", 'A' + p,
+           first[p], mc_first[p], z1, rank[p], mc_rank[p], z2);
+  }
+  printf("+++ Solve: %ld engine games %s the exact values (largest |z| "
+         "%.2f)\n",
+         games, worst_z < 4 ? "agree with" : "DISAGREE with", worst_z);
+  return worst_z < 4 ? 0 : 1;
+}
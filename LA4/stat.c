@@ -0,0 +1,218 @@
+/*
+ * stat.c - ludo-stat: live counters of a running Snake Ludo game
+ * CS39002 Operating Systems Laboratory
+ *
+ * Maps the game's shared state read-only and prints the counters every
+ * interval, vmstat style. Nothing is sent to the game processes.
+ *
+ * Author: Ashutosh Sharma
+ * Roll: 23CS10005
+ */
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "shm.h"
+#include "state.h"
+
+#define HEADER_EVERY 20
+
+const char *stage_names[NUM_STAGES] = {"dispatch", "move", "render", "turn"};
+
+volatile sig_atomic_t should_exit = 0;
+
+void sigint_handler(int sig) { should_exit = 1; }
+
+// map the state segment of the game run by pid (0 = any game)
+struct ludo_state *attach_state(pid_t pid) {
+  char path[SHM_PATH_LEN];
+  pid_t owner = shm_segment_find(pid, "ludo-players", path);
+  if (owner < 0) {
+    fprintf(stderr, "No running game found%s\n", pid ? " for that PID" : "");
+    return NULL;
+  }
+
+  size_t size;
+  int fd = shm_segment_open(path, 0, &size);
+  if (fd < 0)
+    return NULL;
+  if (size != sizeof(struct ludo_state)) {
+    fprintf(stderr, "Game %d uses a different state layout\n", owner);
+    close(fd);
+    return NULL;
+  }
+
+  struct ludo_state *state = shm_segment_map(fd, size, 0);
+  close(fd);
+  if (state != NULL)
+    fprintf(stderr, "+++ ludo-stat: attached to game %d\n", owner);
+  return state;
+}
+
+// plain copy of the counters we print
+struct sample {
+  uint64_t turns, cancelled, overshoot, blocked, chain_blocked, ladders,
+      snakes, finished, redraws, ack_waits;
+  uint64_t count[NUM_STAGES], total_ns[NUM_STAGES];
+};
+
+void take_sample(struct ludo_stats *st, struct sample *s) {
+  s->turns = atomic_load_explicit(&st->turns, memory_order_relaxed);
+  s->cancelled = atomic_load_explicit(&st->cancelled, memory_order_relaxed);
+  s->overshoot = atomic_load_explicit(&st->overshoot, memory_order_relaxed);
+  s->blocked = atomic_load_explicit(&st->blocked, memory_order_relaxed);
+  s->chain_blocked =
+      atomic_load_explicit(&st->chain_blocked, memory_order_relaxed);
+  s->ladders = atomic_load_explicit(&st->ladders, memory_order_relaxed);
+  s->snakes = atomic_load_explicit(&st->snakes, memory_order_relaxed);
+  s->finished = atomic_load_explicit(&st->finished, memory_order_relaxed);
+  s->redraws = atomic_load_explicit(&st->redraws, memory_order_relaxed);
+  s->ack_waits = atomic_load_explicit(&st->ack_waits, memory_order_relaxed);
+  for (int i = 0; i < NUM_STAGES; i++) {
+    s->count[i] =
+        atomic_load_explicit(&st->stages[i].count, memory_order_relaxed);
+    s->total_ns[i] =
+        atomic_load_explicit(&st->stages[i].total_ns, memory_order_relaxed);
+  }
+}
+
+void print_header() {
+  printf("%8s %6s %6s %5s %5s %5s %6s %5s %3s %6s %5s %9s %9s %9s %9s\n",
+         "turns/s", "turns", "cancel", "over", "block", "chain", "ladder",
+         "snake", "fin", "redraw", "waits", "disp_us", "move_us", "rend_us",
+         "turn_us");
+}
+
+// average latency of a stage over the interval, in microseconds
+double interval_us(struct sample *now, struct sample *prev, int stage) {
+  uint64_t n = now->count[stage] - prev->count[stage];
+  return n ? (now->total_ns[stage] - prev->total_ns[stage]) / 1e3 / n : 0.0;
+}
+
+void print_row(struct sample *now, struct sample *prev, double seconds) {
+  printf("%8.1f %6lu %6lu %5lu %5lu %5lu %6lu %5lu %3lu %6lu %5lu %9.1f "
+         "%9.1f %9.1f %9.1f\n",
+         (now->turns - prev->turns) / seconds, now->turns - prev->turns,
+         now->cancelled - prev->cancelled, now->overshoot - prev->overshoot,
+         now->blocked - prev->blocked,
+         now->chain_blocked - prev->chain_blocked,
+         now->ladders - prev->ladders, now->snakes - prev->snakes,
+         now->finished - prev->finished, now->redraws - prev->redraws,
+         now->ack_waits - prev->ack_waits,
+         interval_us(now, prev, STAGE_DISPATCH),
+         interval_us(now, prev, STAGE_MOVE),
+         interval_us(now, prev, STAGE_RENDER),
+         interval_us(now, prev, STAGE_TURN));
+  fflush(stdout);
+}
+
+// -s: every counter and latency histogram since the game started
+void print_summary(struct ludo_state *state) {
+  struct ludo_stats *st = &state->stats;
+  struct sample s;
+  take_sample(st, &s);
+
+  printf("%12lu turns\n", s.turns);
+  printf("%12lu cancelled (three 6s)\n", s.cancelled);
+  printf("%12lu overshoot rejections\n", s.overshoot);
+  printf("%12lu occupancy blocks\n", s.blocked);
+  printf("%12lu chain blocks\n", s.chain_blocked);
+  printf("%12lu ladder hops\n", s.ladders);
+  printf("%12lu snake hops\n", s.snakes);
+  printf("%12lu players finished\n", s.finished);
+  printf("%12lu redraws\n", s.redraws);
+  printf("%12lu ACK waits\n", s.ack_waits);
+  printf("%12lu autoplay deadlines missed\n",
+         atomic_load_explicit(&st->pace_misses, memory_order_relaxed));
+  printf("%12lu narration entries dropped, %lu waits for the writer\n",
+         atomic_load_explicit(&st->log_dropped, memory_order_relaxed),
+         atomic_load_explicit(&st->log_waits, memory_order_relaxed));
+  printf("%12lu move records lost before --log\n",
+         atomic_load_explicit(&st->records_lost, memory_order_relaxed));
+  for (int i = 0; i < STAT_CHAIN_MAX; i++)
+    printf("%12lu moves with %d%s hops\n",
+           atomic_load_explicit(&st->chain_len[i], memory_order_relaxed), i,
+           i == STAT_CHAIN_MAX - 1 ? "+" : "");
+
+  for (int i = 0; i < NUM_STAGES; i++) {
+    struct stage_stat *stage = &st->stages[i];
+    printf("\n%s: %lu samples, mean %.1f us, max %.1f us\n", stage_names[i],
+           s.count[i], s.count[i] ? s.total_ns[i] / 1e3 / s.count[i] : 0.0,
+           atomic_load_explicit(&stage->max_ns, memory_order_relaxed) / 1e3);
+    for (int b = 0; b < STAT_BUCKETS; b++) {
+      uint64_t n = atomic_load_explicit(&stage->hist[b], memory_order_relaxed);
+      if (n)
+        printf("  < %10.1f us %10lu\n", (double)(1ULL << b) / 1e3, n);
+    }
+  }
+}
+
+void print_usage(char *prog_name) {
+  printf("Usage: %s [-p pid] [-s] [interval_s [count]]\n", prog_name);
+  printf("  -p pid  game to watch (CP PID, default: first game found)\n");
+  printf("  -s      print all counters and latency histograms once\n");
+}
+
+int main(int argc, char *argv[]) {
+  pid_t pid = 0;
+  int summary = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "p:sh")) != -1) {
+    switch (opt) {
+    case 'p':
+      pid = atoi(optarg);
+      break;
+    case 's':
+      summary = 1;
+      break;
+    default:
+      print_usage(argv[0]);
+      return opt == 'h' ? 0 : 1;
+    }
+  }
+
+  double interval = optind < argc ? atof(argv[optind]) : 1.0;
+  long count = optind + 1 < argc ? atol(argv[optind + 1]) : -1;
+  if (interval <= 0) {
+    fprintf(stderr, "Error: interval must be positive\n");
+    return 1;
+  }
+
+  struct ludo_state *state = attach_state(pid);
+  if (state == NULL)
+    return 1;
+
+  if (summary) {
+    print_summary(state);
+    return 0;
+  }
+
+  signal(SIGINT, sigint_handler);
+
+  struct sample prev, now;
+  take_sample(&state->stats, &prev);
+  uint64_t last = stat_now_ns();
+  struct timespec ts = {(time_t)interval,
+                        (long)((interval - (time_t)interval) * 1e9)};
+
+  for (long row = 0; !should_exit && (count < 0 || row < count); row++) {
+    if (row % HEADER_EVERY == 0)
+      print_header();
+    nanosleep(&ts, NULL);
+
+    take_sample(&state->stats, &now);
+    uint64_t t = stat_now_ns();
+    print_row(&now, &prev, (t - last) / 1e9);
+    prev = now;
+    last = t;
+  }
+
+  munmap(state, sizeof(*state));
+  return 0;
+}
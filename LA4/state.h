@@ -0,0 +1,42 @@
+/*
+ * state.h - Layout of the shared game state segment
+ * CS39002 Operating Systems Laboratory
+ *
+ * players[] keeps the original layout (positions, then the active count
+ * at players[num_players]); everything the processes use to talk to each
+ * other during a turn follows it.
+ *
+ * Author: Ashutosh Sharma
+ * Roll: 23CS10005
+ */
+
+#ifndef STATE_H
+#define STATE_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+#include "engine.h"
+#include "logring.h"
+#include "ring.h"
+#include "stats.h"
+
+struct ludo_state {
+  int players[MAX_PLAYERS + 1];
+  _Atomic uint32_t turn;     // last turn requested by the CP
+  _Atomic uint32_t events;   // bumped after every published record (futex)
+  _Atomic uint32_t rendered; // last turn drawn by the BP (futex)
+  _Atomic uint32_t frames;   // bumped after each redraw, for spectators (futex)
+  _Atomic uint32_t batch_end; // last turn of a next N batch, played by the PP
+  uint32_t render_every;      // BP draws every this many turns of a batch
+  int num_players;
+  int current;                // player who moved last, -1 at the start (PP)
+  uint64_t dice[MAX_PLAYERS]; // each player's dice stream (rng.h)
+  _Atomic uint32_t log_seq;   // narration entries written (logring.h)
+  struct ludo_stats stats __attribute__((aligned(64)));
+  struct event_ring rings[MAX_PLAYERS] __attribute__((aligned(64)));
+  // narration of each player, then of the PP itself (narrate.h)
+  struct log_ring logs[MAX_PLAYERS + 1] __attribute__((aligned(64)));
+};
+
+#endif
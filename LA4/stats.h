@@ -0,0 +1,85 @@
+/*
+ * stats.h - Hot-path counters kept in the shared game state
+ * CS39002 Operating Systems Laboratory
+ *
+ * Every process bumps these with relaxed atomics; readers such as
+ * ludo-stat just map the segment read-only and sample them.
+ *
+ * Author: Ashutosh Sharma
+ * Roll: 23CS10005
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <time.h>
+
+#define STAT_BUCKETS 32 // bucket b counts latencies in [2^(b-1), 2^b) ns,
+                        // the last one everything from 2^30 ns up
+#define STAT_CHAIN_MAX 8 // chains of 7+ hops share the last bucket
+
+// stages of a turn, timed by the process that finishes them
+#define STAGE_DISPATCH 0 // CP request -> player wakes up (CP, PP signals)
+#define STAGE_MOVE 1     // player wakes up -> move published
+#define STAGE_RENDER 2   // BP starts drawing -> board drawn
+#define STAGE_TURN 3     // CP request -> board drawn, as seen by the CP
+#define NUM_STAGES 4
+
+struct stage_stat {
+  _Atomic uint64_t count;
+  _Atomic uint64_t total_ns;
+  _Atomic uint64_t max_ns;
+  _Atomic uint64_t hist[STAT_BUCKETS];
+};
+
+struct ludo_stats {
+  _Atomic uint64_t turns;
+  _Atomic uint64_t cancelled;     // three 6s
+  _Atomic uint64_t overshoot;     // moves past 100 rejected
+  _Atomic uint64_t blocked;       // target cell occupied
+  _Atomic uint64_t chain_blocked; // snake/ladder end occupied
+  _Atomic uint64_t ladders;
+  _Atomic uint64_t snakes;
+  _Atomic uint64_t finished;
+  _Atomic uint64_t redraws;
+  _Atomic uint64_t ack_waits;   // times the CP slept waiting for the BP
+  _Atomic uint64_t pace_misses; // autoplay turns started past their deadline
+  _Atomic uint64_t log_dropped; // narration entries that found a ring full
+  _Atomic uint64_t log_waits;   // times a player waited for the log writer
+  _Atomic uint64_t records_lost; // move records overwritten before --log
+  _Atomic uint64_t chain_len[STAT_CHAIN_MAX];
+  _Atomic uint64_t turn_start_ns; // when the CP requested the current turn
+  struct stage_stat stages[NUM_STAGES];
+};
+
+static inline uint64_t stat_now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static inline void stat_add(_Atomic uint64_t *counter, uint64_t n) {
+  atomic_fetch_add_explicit(counter, n, memory_order_relaxed);
+}
+
+static inline int stat_bucket(uint64_t ns) {
+  int b = ns ? 64 - __builtin_clzll(ns) : 0;
+  return b < STAT_BUCKETS ? b : STAT_BUCKETS - 1;
+}
+
+static inline void stat_time(struct ludo_stats *st, int stage, uint64_t ns) {
+  struct stage_stat *s = &st->stages[stage];
+  stat_add(&s->count, 1);
+  stat_add(&s->total_ns, ns);
+  stat_add(&s->hist[stat_bucket(ns)], 1);
+
+  uint64_t max = atomic_load_explicit(&s->max_ns, memory_order_relaxed);
+  while (ns > max && !atomic_compare_exchange_weak_explicit(
+                         &s->max_ns, &max, ns, memory_order_relaxed,
+                         memory_order_relaxed))
+    ;
+}
+
+#endif
@@ -0,0 +1,88 @@
+/*
+ * trace.c - Cross-process turn tracing for Snake Ludo
+ * CS39002 Operating Systems Laboratory
+ *
+ * Author: Ashutosh Sharma
+ * Roll: 23CS10005
+ */
+
+#include "trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "shm.h"
+
+#define TRACE_BYTES (TRACE_BUFFERS * sizeof(struct trace_buffer))
+
+const char *trace_point_names[NUM_TRACE_POINTS] = {
+    "turn",        "signal", "wait", "dispatch", "dice",  "commit",
+    "record wait", "render", "ack",  "ack wait", "write"};
+
+struct trace_buffer *trace_buffers = NULL;
+
+int trace_create() {
+  char path[SHM_PATH_LEN];
+
+  // the fd stays open, children open the segment through it
+  int fd = shm_segment_create("ludo-trace", TRACE_BYTES, 0);
+  if (fd < 0)
+    return -1;
+  trace_buffers = shm_segment_map(fd, TRACE_BYTES, 1);
+  if (trace_buffers == NULL)
+    return -1;
+  shm_segment_path(fd, path);
+  setenv("LUDO_TRACE", path, 1);
+  return 0;
+}
+
+int trace_attach() {
+  const char *path = getenv("LUDO_TRACE");
+  size_t bytes;
+
+  if (path == NULL)
+    return 0;
+  int fd = shm_segment_open(path, 1, &bytes);
+  if (fd < 0)
+    return -1;
+  if (bytes != TRACE_BYTES) {
+    fprintf(stderr, "%s: trace segment of %zu bytes, expected %zu\n", path,
+            bytes, TRACE_BYTES);
+    close(fd);
+    return -1;
+  }
+  trace_buffers = shm_segment_map(fd, bytes, 1);
+  close(fd);
+  return trace_buffers != NULL ? 0 : -1;
+}
+
+void trace_claim(int buffer) {
+  if (trace_buffers != NULL)
+    trace_buffers[buffer].pid = getpid();
+}
+
+int trace_dump(const char *path) {
+  FILE *fp = fopen(path, "w");
+  if (fp == NULL) {
+    perror("fopen (trace)");
+    return -1;
+  }
+
+  struct trace_file_header header = {TRACE_MAGIC, TRACE_BUFFERS, 0};
+  fwrite(&header, sizeof(header), 1, fp);
+  for (int i = 0; i < TRACE_BUFFERS; i++) {
+    struct trace_buffer *b = &trace_buffers[i];
+    struct trace_file_buffer fb = {b->pid, atomic_load(&b->count),
+                                   atomic_load(&b->dropped), 0};
+    fwrite(&fb, sizeof(fb), 1, fp);
+    fwrite(b->events, sizeof(b->events[0]), fb.count, fp);
+  }
+  if (fclose(fp) != 0) {
+    perror("fclose (trace)");
+    return -1;
+  }
+  return 0;
+}
@@ -0,0 +1,112 @@
+/*
+ * trace.h - Cross-process turn tracing for Snake Ludo
+ * CS39002 Operating Systems Laboratory
+ *
+ * With ludo --trace the CP creates one more segment, a buffer of events
+ * for every thread that records (CP, BP, PP, its narration writer and
+ * each player), and names it to its children in LUDO_TRACE. Each buffer
+ * has a single producer and only fills up, so recording an event is a
+ * clock read and a store. At the end the CP dumps the buffers to a file
+ * and ludo-trace turns that into Chrome trace JSON, which Perfetto and
+ * chrome://tracing show as one timeline.
+ *
+ * Author: Ashutosh Sharma
+ * Roll: 23CS10005
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+#include "engine.h"
+#include "stats.h"
+
+#define TRACE_EVENTS 65536 // per buffer; recording stops once one is full
+#define TRACE_MAGIC "LUDOTRC1"
+
+// buffers, one per recording thread
+#define TRACE_CP 0
+#define TRACE_BP 1
+#define TRACE_PP 2
+#define TRACE_LOG 3 // the PP's narration writer
+#define TRACE_PLAYER(i) (4 + (i))
+#define TRACE_BUFFERS (4 + MAX_PLAYERS)
+
+// what an event marks; spans have a begin and an end, the rest are
+// instants
+#define TRACE_TURN 0        // CP: turn requested -> drawn (span)
+#define TRACE_SIGNAL 1      // CP, PP: kill() to wake the next process
+#define TRACE_WAIT 2        // PP, players: in sigsuspend(); BP: idle (span)
+#define TRACE_DISPATCH 3    // PP: picking the next player and waking it (span)
+#define TRACE_DICE 4        // player: rolling (span)
+#define TRACE_COMMIT 5      // player: publishing the move record (span)
+#define TRACE_RECORD_WAIT 6 // PP: a batch turn's record not yet out (span)
+#define TRACE_RENDER 7      // BP: drawing, terminal writes included (span)
+#define TRACE_ACK 8         // BP: turn marked as drawn
+#define TRACE_ACK_WAIT 9    // CP: waiting for the BP (span)
+#define TRACE_WRITE 10      // PP: narration written to the terminal (span)
+#define NUM_TRACE_POINTS 11
+
+#define TRACE_BEGIN 'B'
+#define TRACE_END 'E'
+#define TRACE_MARK 'i'
+
+struct trace_event {
+  uint64_t ts_ns; // CLOCK_MONOTONIC, the same clock in every process
+  uint32_t turn;  // turn id the event belongs to
+  uint8_t point;  // TRACE_* above
+  uint8_t phase;  // TRACE_BEGIN, TRACE_END or TRACE_MARK
+  uint8_t pad[2];
+};
+
+struct trace_buffer {
+  _Atomic uint32_t count;   // events recorded
+  _Atomic uint32_t dropped; // events that found the buffer full
+  int32_t pid;              // 0 if nothing has claimed the buffer
+  char pad[52];
+  struct trace_event events[TRACE_EVENTS];
+};
+
+// dump file: this header, then for each buffer a trace_file_buffer and
+// its count events
+struct trace_file_header {
+  char magic[8];
+  uint32_t buffers;
+  uint32_t pad;
+};
+
+struct trace_file_buffer {
+  int32_t pid;
+  uint32_t count;
+  uint32_t dropped;
+  uint32_t pad;
+};
+
+extern const char *trace_point_names[NUM_TRACE_POINTS];
+extern struct trace_buffer *trace_buffers; // NULL unless tracing
+
+// CP: create the segment and export LUDO_TRACE to the children
+int trace_create();
+// the segment named in LUDO_TRACE, if there is one
+int trace_attach();
+// record into buffer from this process from now on
+void trace_claim(int buffer);
+// CP: write every buffer to path
+int trace_dump(const char *path);
+
+static inline void trace(int buffer, int point, int phase, uint32_t turn) {
+  if (trace_buffers == NULL)
+    return;
+  struct trace_buffer *b = &trace_buffers[buffer];
+  uint32_t n = atomic_load_explicit(&b->count, memory_order_relaxed);
+  if (n >= TRACE_EVENTS) {
+    atomic_fetch_add_explicit(&b->dropped, 1, memory_order_relaxed);
+    return;
+  }
+  b->events[n] = (struct trace_event){stat_now_ns(), turn, point, phase, {0}};
+  atomic_store_explicit(&b->count, n + 1, memory_order_release);
+}
+
+#endif
@@ -0,0 +1,299 @@
+/*
+ * tracejson.c - ludo-trace: Chrome trace JSON from a ludo --trace file
+ * CS39002 Operating Systems Laboratory
+ *
+ * Usage: ludo-trace <file> > trace.json
+ *
+ * Merges the per-process buffers into one timeline: a process per OS
+ * process and a thread per buffer, so player tasks show up as threads
+ * of the PP. Spans and instants carry their turn id, and each turn's
+ * path through the processes (signal, dispatch, dice, render, ACK) is
+ * drawn as a flow with the turn id as its id. Load the output in
+ * ui.perfetto.dev or chrome://tracing. A summary of where the time
+ * went goes to stderr.
+ *
+ * Author: Ashutosh Sharma
+ * Roll: 23CS10005
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trace.h"
+
+struct merged {
+  uint64_t ts_ns;
+  uint32_t turn;
+  uint8_t point;
+  uint8_t phase;
+  uint16_t buffer;
+  uint32_t seq; // position in its buffer, keeps sorting stable
+};
+
+// one step of a turn's flow
+struct flow_point {
+  uint32_t turn;
+  uint16_t buffer;
+  uint64_t ts_ns;
+};
+
+struct span_stat {
+  long count;
+  uint64_t total_ns;
+  uint64_t max_ns;
+};
+
+int32_t pids[TRACE_BUFFERS];
+uint32_t dropped[TRACE_BUFFERS];
+int printed = 0; // events written so far
+const char player_symbols[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+
+// start the next element of traceEvents
+void next_event() {
+  if (printed++ > 0)
+    printf(",\n");
+}
+
+void buffer_name(int b, char *name, size_t size) {
+  static const char *fixed[] = {"CP", "BP", "PP", "narration writer"};
+  if (b < TRACE_PLAYER(0))
+    snprintf(name, size, "%s", fixed[b]);
+  else
+    snprintf(name, size, "player %c", player_symbols[b - TRACE_PLAYER(0)]);
+}
+
+#define NUM_CATEGORIES 4
+const char *categories[NUM_CATEGORIES] = {"cp", "bp", "pp", "player"};
+
+// the kind of process a buffer records for
+int buffer_category(int b) {
+  static const int fixed[] = {0, 1, 2, 2};
+  return b < TRACE_PLAYER(0) ? fixed[b] : 3;
+}
+
+int by_time(const void *a, const void *b) {
+  const struct merged *x = a, *y = b;
+  if (x->ts_ns != y->ts_ns)
+    return x->ts_ns < y->ts_ns ? -1 : 1;
+  if (x->buffer != y->buffer)
+    return x->buffer - y->buffer;
+  return x->seq < y->seq ? -1 : x->seq > y->seq;
+}
+
+int by_turn(const void *a, const void *b) {
+  const struct flow_point *x = a, *y = b;
+  if (x->turn != y->turn)
+    return x->turn < y->turn ? -1 : 1;
+  return x->ts_ns < y->ts_ns ? -1 : x->ts_ns > y->ts_ns;
+}
+
+// read a dump into events (sorted by time), returns the count or -1
+long load(const char *path, struct merged **out) {
+  FILE *fp = fopen(path, "r");
+  if (fp == NULL) {
+    perror(path);
+    return -1;
+  }
+
+  struct trace_file_header header;
+  if (fread(&header, sizeof(header), 1, fp) != 1 ||
+      memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0 ||
+      header.buffers != TRACE_BUFFERS) {
+    fprintf(stderr, "%s: not a trace from this build of ludo\n", path);
+    fclose(fp);
+    return -1;
+  }
+
+  struct merged *events = NULL;
+  long n = 0;
+  for (int b = 0; b < TRACE_BUFFERS; b++) {
+    struct trace_file_buffer fb;
+    if (fread(&fb, sizeof(fb), 1, fp) != 1 || fb.count > TRACE_EVENTS) {
+      fprintf(stderr, "%s: truncated\n", path);
+      fclose(fp);
+      free(events);
+      return -1;
+    }
+    pids[b] = fb.pid;
+    dropped[b] = fb.dropped;
+
+    events = realloc(events, (n + fb.count) * sizeof(*events));
+    if (events == NULL && n + fb.count > 0) {
+      perror("realloc");
+      fclose(fp);
+      return -1;
+    }
+    for (uint32_t i = 0; i < fb.count; i++) {
+      struct trace_event e;
+      if (fread(&e, sizeof(e), 1, fp) != 1 || e.point >= NUM_TRACE_POINTS) {
+        fprintf(stderr, "%s: truncated\n", path);
+        fclose(fp);
+        free(events);
+        return -1;
+      }
+      events[n++] = (struct merged){e.ts_ns, e.turn, e.point, e.phase, b, i};
+    }
+  }
+  fclose(fp);
+
+  qsort(events, n, sizeof(*events), by_time);
+  *out = events;
+  return n;
+}
+
+void print_metadata() {
+  char name[32];
+  for (int b = 0; b < TRACE_BUFFERS; b++) {
+    if (pids[b] == 0)
+      continue;
+    // a process is named after its first buffer: player tasks share the
+    // PP's pid and appear as its threads
+    int first = 1;
+    for (int a = 0; a < b; a++)
+      first &= pids[a] != pids[b];
+    buffer_name(b, name, sizeof(name));
+    if (first) {
+      next_event();
+      printf("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,"
+             "\"args\":{\"name\":\"%s\"}}",
+             pids[b], b, name);
+    }
+    next_event();
+    printf("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,"
+           "\"args\":{\"name\":\"%s\"}}",
+           pids[b], b, name);
+  }
+}
+
+// the point where an event joins its turn's flow, 0 if it does not;
+// flow steps bind to the slice around them, so they sit just inside it
+uint64_t flow_ts(const struct merged *e) {
+  if (e->turn == 0)
+    return 0;
+  if (e->point == TRACE_SIGNAL && e->buffer == TRACE_CP)
+    return e->ts_ns;
+  if (e->phase == TRACE_BEGIN &&
+      (e->point == TRACE_DISPATCH || e->point == TRACE_DICE ||
+       e->point == TRACE_RENDER))
+    return e->ts_ns + 1;
+  if (e->phase == TRACE_END && e->point == TRACE_ACK_WAIT)
+    return e->ts_ns - 1;
+  return 0;
+}
+
+void print_flows(struct flow_point *flows, long n, uint64_t base) {
+  qsort(flows, n, sizeof(*flows), by_turn);
+  for (long i = 0; i < n;) {
+    long j = i;
+    while (j < n && flows[j].turn == flows[i].turn)
+      j++;
+    for (long k = i; j - i > 1 && k < j; k++) {
+      char ph = k == i ? 's' : k == j - 1 ? 'f' : 't';
+      next_event();
+      printf("{\"name\":\"turn\",\"cat\":\"turn\",\"ph\":\"%c\","
+             "\"id\":%u,\"ts\":%.3f,\"pid\":%d,\"tid\":%d,\"bp\":\"e\"}",
+             ph, flows[k].turn, (flows[k].ts_ns - base) / 1e3,
+             pids[flows[k].buffer], flows[k].buffer);
+    }
+    i = j;
+  }
+}
+
+// time in each kind of span and process, from begin/end pairs per
+// buffer
+void print_summary(const struct merged *events, long n) {
+  struct span_stat spans[NUM_CATEGORIES][NUM_TRACE_POINTS] = {{{0}}};
+  long marks[NUM_CATEGORIES][NUM_TRACE_POINTS] = {{0}};
+  uint64_t open[TRACE_BUFFERS][NUM_TRACE_POINTS] = {{0}};
+
+  for (long i = 0; i < n; i++) {
+    const struct merged *e = &events[i];
+    int c = buffer_category(e->buffer);
+    if (e->phase == TRACE_MARK) {
+      marks[c][e->point]++;
+    } else if (e->phase == TRACE_BEGIN) {
+      open[e->buffer][e->point] = e->ts_ns;
+    } else if (open[e->buffer][e->point] != 0) {
+      uint64_t d = e->ts_ns - open[e->buffer][e->point];
+      struct span_stat *s = &spans[c][e->point];
+      s->count++;
+      s->total_ns += d;
+      if (d > s->max_ns)
+        s->max_ns = d;
+      open[e->buffer][e->point] = 0;
+    }
+  }
+
+  fprintf(stderr, "%-7s %-12s %8s %12s %10s %10s\n", "process", "event",
+          "count", "total ms", "mean us", "max us");
+  for (int c = 0; c < NUM_CATEGORIES; c++) {
+    for (int p = 0; p < NUM_TRACE_POINTS; p++) {
+      struct span_stat *s = &spans[c][p];
+      if (s->count > 0)
+        fprintf(stderr, "%-7s %-12s %8ld %12.3f %10.1f %10.1f\n",
+                categories[c], trace_point_names[p], s->count,
+                s->total_ns / 1e6, s->total_ns / 1e3 / s->count,
+                s->max_ns / 1e3);
+      else if (marks[c][p] > 0)
+        fprintf(stderr, "%-7s %-12s %8ld\n", categories[c],
+                trace_point_names[p], marks[c][p]);
+    }
+  }
+
+  char name[32];
+  for (int b = 0; b < TRACE_BUFFERS; b++) {
+    if (dropped[b] == 0)
+      continue;
+    buffer_name(b, name, sizeof(name));
+    fprintf(stderr, "%s: %u events dropped, its buffer was full\n", name,
+            dropped[b]);
+  }
+}
+
+int main(int argc, char *argv[]) {
+  if (argc != 2) {
+    fprintf(stderr, "Usage: %s <file> > trace.json\n"
+                    "  file: written by ludo --trace <file>\n",
+            argv[0]);
+    return 1;
+  }
+
+  struct merged *events = NULL;
+  long n = load(argv[1], &events);
+  if (n < 0)
+    return 1;
+  struct flow_point *flows = malloc((n + 1) * sizeof(*flows));
+  if (flows == NULL) {
+    perror("malloc");
+    return 1;
+  }
+  long nflows = 0;
+  uint64_t base = n > 0 ? events[0].ts_ns - 1 : 0;
+
+  printf("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+  print_metadata();
+  for (long i = 0; i < n; i++) {
+    const struct merged *e = &events[i];
+    next_event();
+    printf("{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,"
+           "\"pid\":%d,\"tid\":%d,",
+           trace_point_names[e->point],
+           categories[buffer_category(e->buffer)], e->phase, (e->ts_ns - base) / 1e3,
+           pids[e->buffer], e->buffer);
+    if (e->phase == TRACE_MARK)
+      printf("\"s\":\"t\",");
+    printf("\"args\":{\"turn\":%u}}", e->turn);
+
+    uint64_t ts = flow_ts(e);
+    if (ts != 0)
+      flows[nflows++] = (struct flow_point){e->turn, e->buffer, ts};
+  }
+  print_flows(flows, nflows, base);
+  printf("\n]}\n");
+
+  print_summary(events, n);
+  free(flows);
+  free(events);
+  return 0;
+}